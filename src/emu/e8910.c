@@ -27,6 +27,10 @@ enum
 {
 	SOUND_FREQ = 22050,
 	SOUND_SAMPLE = 1024,
+	CPU_MHZ = 1500000, /* cpu cycles per second, the clock of the queue */
+
+	/* the audio runs this many cycles behind the emulation, a buffer */
+	QUEUE_LATENCY = SOUND_SAMPLE * (CPU_MHZ / SOUND_FREQ),
 	TUNEA = 1, /* tuning muliplayer */
 	TUNEB = 2, /* tuning divider */
 
@@ -52,12 +56,46 @@ enum
 	AY_PORTB = 15
 };
 
+/* bits of each sound register the generator keeps */
+static const uint8_t reg_mask[AY_PORTA] =
+{
+	0xff, 0x0f, 0xff, 0x0f, 0xff, 0x0f, 0x1f, 0xff, 0x1f, 0x1f, 0x1f, 0xff, 0xff, 0x0f
+};
+
 uint8_t e8910_read(AY8910 *PSG, uint8_t r)
 {
-    return PSG->regs[r];
+    return PSG->shadow[r];
+}
+
+void e8910_write(AY8910 *PSG, uint32_t cycle, uint8_t r, uint8_t v)
+{
+	int head = SDL_AtomicGet(&PSG->head);
+	e8910_rec *rec;
+
+	PSG->shadow[r] = v;
+
+	/* the ports make no sound */
+	if (r >= AY_PORTA)
+		return;
+
+	/* a slot stays empty so a full queue differs from an empty one */
+	if (((head + 1) & (E8910_QUEUE - 1)) == SDL_AtomicGet(&PSG->tail))
+	{
+		/* the audio takes it from shadow instead */
+		PSG->dropped++;
+		SDL_AtomicSet(&PSG->overflow, 1);
+		return;
+	}
+
+	rec = &PSG->queue[head];
+	rec->cycle = cycle;
+	rec->reg = r;
+	rec->value = v;
+
+	SDL_AtomicSet(&PSG->head, (head + 1) & (E8910_QUEUE - 1));
 }
 
-void e8910_write(AY8910 *PSG, uint8_t r, uint8_t v)
+static void write_reg(AY8910 *PSG, uint8_t r, uint8_t v)
 {
 	int32_t old;
 
@@ -190,10 +228,8 @@ void e8910_write(AY8910 *PSG, uint8_t r, uint8_t v)
 	}
 }
 
-static void e8910_callback(void *userdata, uint8_t *stream, int length)
+static void generate(AY8910 *PSG, uint8_t *stream, int length)
 {
-    AY8910 *PSG = (AY8910 *)userdata;
-
 	int outn;
 	uint8_t* buf1 = stream;
 	static uint16_t last_vol = 128;
@@ -452,13 +488,114 @@ static void e8910_callback(void *userdata, uint8_t *stream, int length)
 	}
 }
 
+/* the audio fell a whole queue behind, bring it up to shadow at once. the
+ * flag is cleared before shadow is read so a write lost meanwhile sets it
+ * again.
+ */
+static void catch_up(AY8910 *PSG)
+{
+	int head = SDL_AtomicGet(&PSG->head);
+	int tail = SDL_AtomicGet(&PSG->tail);
+
+	SDL_AtomicSet(&PSG->overflow, 0);
+
+	for (; tail != head; tail = (tail + 1) & (E8910_QUEUE - 1))
+		write_reg(PSG, PSG->queue[tail].reg, PSG->queue[tail].value);
+
+	SDL_AtomicSet(&PSG->tail, tail);
+
+	for (uint8_t r = 0; r < AY_PORTA; r++)
+	{
+		uint8_t v = PSG->shadow[r];
+
+		if ((v & reg_mask[r]) != PSG->regs[r])
+			write_reg(PSG, r, v);
+	}
+
+	PSG->synced = 0;
+}
+
+static void e8910_callback(void *userdata, uint8_t *stream, int length)
+{
+	AY8910 *PSG = (AY8910 *)userdata;
+	int head, tail;
+
+	if (SDL_AtomicGet(&PSG->overflow))
+		catch_up(PSG);
+
+	head = SDL_AtomicGet(&PSG->head);
+	tail = SDL_AtomicGet(&PSG->tail);
+
+	while (length > 0)
+	{
+		int n = length;
+
+		/* apply the writes that are due, up to the next one that is not */
+		while (tail != head)
+		{
+			const e8910_rec *rec = &PSG->queue[tail];
+			int32_t ahead = (int32_t)(rec->cycle - PSG->clock);
+
+			/* the emulation was paused, reset or ran faster than real
+			 * time, start over a buffer behind it
+			 */
+			if (!PSG->synced || ahead < -QUEUE_LATENCY || ahead > 4 * QUEUE_LATENCY)
+			{
+				PSG->clock = rec->cycle - QUEUE_LATENCY;
+				PSG->clock_rem = 0;
+				PSG->synced = 1;
+				ahead = QUEUE_LATENCY;
+			}
+
+			if (ahead > 0)
+			{
+				int64_t due = ((int64_t)ahead * SOUND_FREQ + CPU_MHZ - 1) / CPU_MHZ;
+
+				if (due < n)
+					n = (int)due;
+				break;
+			}
+
+			write_reg(PSG, rec->reg, rec->value);
+			tail = (tail + 1) & (E8910_QUEUE - 1);
+		}
+
+		generate(PSG, stream, n);
+		stream += n;
+		length -= n;
+
+		PSG->clock_rem += (uint32_t)n * CPU_MHZ;
+		PSG->clock += PSG->clock_rem / SOUND_FREQ;
+		PSG->clock_rem %= SOUND_FREQ;
+	}
+
+	SDL_AtomicSet(&PSG->tail, tail);
+}
+
 void e8910_reset(AY8910 *PSG)
 {
+	/* vecx_reset starts the cycles over */
 	for (uint8_t r = 0; r < 16; r++)
-		e8910_write(PSG, r, 0);
+		e8910_write(PSG, 0, r, 0);
 
 	/* input buttons */
-	e8910_write(PSG, 14, 0xff);
+	e8910_write(PSG, 0, 14, 0xff);
+}
+
+void e8910_sync(AY8910 *PSG)
+{
+	catch_up(PSG);
+}
+
+void e8910_flush(AY8910 *PSG)
+{
+	SDL_AtomicSet(&PSG->tail, SDL_AtomicGet(&PSG->head));
+	SDL_AtomicSet(&PSG->overflow, 0);
+
+	for (uint8_t r = 0; r < 16; r++)
+		PSG->regs[r] = r < AY_PORTA ? PSG->shadow[r] & reg_mask[r] : PSG->shadow[r];
+
+	PSG->synced = 0;
 }
 
 void e8910_init(AY8910 *PSG)
@@ -473,6 +610,12 @@ void e8910_init(AY8910 *PSG)
 	PSG->out_c = 0;
 	PSG->out_n = 0xff;
 
+	/* the queued writes of the reset are only due a buffer in, the
+	 * generator needs sane periods before that
+	 */
+	for (uint8_t r = 0; r < 16; r++)
+		write_reg(PSG, r, 0);
+
 	// set up audio buffering
 	reqSpec.freq = SOUND_FREQ;            // Audio frequency in samples per second
 	reqSpec.format = AUDIO_U8;          // Audio data format
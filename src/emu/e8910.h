@@ -1,9 +1,24 @@
 #ifndef __E8910_H
 #define __E8910_H
 
+#include <SDL.h>
+
+enum
+{
+	E8910_QUEUE = 4096 /* register writes in flight, a power of two */
+};
+
+/* a register write and the cpu cycle it happened at */
+typedef struct
+{
+	uint32_t cycle;
+	uint8_t reg;
+	uint8_t value;
+} e8910_rec;
+
 typedef struct
 {
-	uint8_t regs[16];
+	uint8_t regs[16]; /* as the sound generator sees them, audio thread only */
 	int32_t per_a, per_b, per_c, per_n, per_e; /* Period */
 	int32_t cnt_a, cnt_b, cnt_c, cnt_n, cnt_e; /* count */
 	uint32_t vol_a, vol_b, vol_c, vol_e;
@@ -13,12 +28,39 @@ typedef struct
 	uint8_t hold, alternate, attack, holding;
 	int32_t RNG;
 
+	/* writes go from the emulation thread to the audio thread through a
+	 * single producer, single consumer ring. the audio thread applies each
+	 * one at the sample its cycle falls on, running a buffer behind the
+	 * emulation.
+	 */
+	e8910_rec queue[E8910_QUEUE];
+	SDL_atomic_t head;    /* next record to fill, written by the emulation */
+	SDL_atomic_t tail;    /* next record to apply, written by the audio */
+	uint8_t shadow[16];   /* registers as the emulation sees them */
+	uint32_t dropped;     /* writes that found the queue full */
+	SDL_atomic_t overflow; /* the audio has to catch up with shadow */
+
+	uint32_t clock;       /* cycle of the next sample */
+	uint32_t clock_rem;   /* clock fraction in 1 / SOUND_FREQ cycles */
+	int synced;           /* clock follows the queue */
 } AY8910;
 
 void e8910_reset(AY8910 *PSG);
 void e8910_init(AY8910 *PSG);
 void e8910_done(AY8910 *PSG);
 uint8_t e8910_read(AY8910 *PSG, uint8_t r);
-void e8910_write(AY8910 *PSG, uint8_t r, uint8_t v);
+
+/* write a register at a cpu cycle, from the emulation thread */
+void e8910_write(AY8910 *PSG, uint32_t cycle, uint8_t r, uint8_t v);
+
+/* apply the queued writes and any the queue had no room for at once, with
+ * the audio locked. regs match shadow afterwards.
+ */
+void e8910_sync(AY8910 *PSG);
+
+/* drop the queued writes and take shadow as the registers, with the audio
+ * locked. for the generator state being loaded along with shadow.
+ */
+void e8910_flush(AY8910 *PSG);
 
 #endif
@@ -131,6 +131,9 @@ void dac_sstep(DACVec *DAC)
 			DAC->vector_dx = sig_dx;
 			DAC->vector_dy = sig_dy;
 			DAC->vector_color = (uint8_t)DAC->zsh;
+
+			if (DAC->start_line)
+				DAC->start_line(DAC->userdata);
 		}
 	}
 	else
@@ -171,6 +174,9 @@ void dac_sstep(DACVec *DAC)
 				DAC->vector_dx = sig_dx;
 				DAC->vector_dy = sig_dy;
 				DAC->vector_color = (uint8_t)DAC->zsh;
+
+				if (DAC->start_line)
+					DAC->start_line(DAC->userdata);
 			}
 			else
 			{
@@ -43,6 +43,9 @@ typedef struct
 
     void *userdata;
     void(*add_line) (void* userdata, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color);
+
+    /* called when a vector starts, left NULL unless someone needs to know */
+    void(*start_line) (void* userdata);
 } DACVec;
 
 void dac_update(DACVec *DAC);
@@ -9,6 +9,7 @@
 #include "e6522.h"
 #include "e8910.h"
 #include "edac.h"
+#include "vlist.h"
 
 //void(*vecx_render) (void);
 
@@ -37,7 +38,7 @@ static void snd_update(vecx *vecx)
 		break;
 	case 0x10:
 		/* the sound chip is recieving data */
-		if (vecx->snd_select != 14) e8910_write(&vecx->PSG, vecx->snd_select, vecx->VIA.ora);
+		if (vecx->snd_select != 14) e8910_write(&vecx->PSG, vecx->cycles, vecx->snd_select, vecx->VIA.ora);
 		break;
 	case 0x18:
 		/* the sound chip is latching an address */
@@ -151,14 +152,44 @@ static void write8(vecx *vecx, uint16_t address, uint8_t data)
 	}
 }
 
-static void addline(vecx *vecx, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color)
+/* the dac hooks get vecx as their userdata */
+static void addline(void *userdata, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color)
 {
-    vecx->vectors[vecx->vector_draw_cnt].x0 = x0;
-    vecx->vectors[vecx->vector_draw_cnt].y0 = y0;
-    vecx->vectors[vecx->vector_draw_cnt].x1 = x1;
-    vecx->vectors[vecx->vector_draw_cnt].y1 = y1;
-    vecx->vectors[vecx->vector_draw_cnt].color = color;
-    vecx->vector_draw_cnt++;
+    vecx *vecx = userdata;
+
+    vlist_add(vecx->vectors, x0, y0, x1, y1, color, (uint16_t)(vecx->cycles - vecx->frame_start));
+}
+
+static void addline_traced(void *userdata, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color)
+{
+    vecx *vecx = userdata;
+
+    vlist_add_traced(vecx->vectors, x0, y0, x1, y1, color, (uint16_t)(vecx->cycles - vecx->frame_start),
+        vecx->line_pc, vecx->line_caller, vecx->cycles - vecx->line_start);
+}
+
+/* the dac is stepped after the instruction that turned the beam on has
+ * executed, so the program counter points at the next one. still inside
+ * the drawing routine which is what matters.
+ */
+static void startline(void *userdata)
+{
+    vecx *vecx = userdata;
+    uint16_t s = vecx->CPU.reg_s;
+
+    vecx->line_pc = vecx->CPU.reg_pc;
+    vecx->line_start = vecx->cycles;
+    vecx->line_caller = 0;
+
+    /* only peek at the stack when both bytes are in ram. like read8 that is
+     * 0xc800-0xcfff and its mirror at 0xd800-0xdfff, the rest of
+     * 0xc000-0xdfff is io where reads have side effects.
+     */
+    if (vecx->trace == VECX_TRACE_CALLER && (s & 0xe800) == 0xc800 &&
+        ((uint16_t)(s + 1) & 0xe800) == 0xc800)
+    {
+        vecx->line_caller = (uint16_t)(vecx->ram[s & 0x3ff] << 8 | vecx->ram[(s + 1) & 0x3ff]);
+    }
 }
 
 void vecx_input(vecx *vecx, uint8_t key, uint8_t value)
@@ -166,15 +197,15 @@ void vecx_input(vecx *vecx, uint8_t key, uint8_t value)
 	uint8_t psg_io = e8910_read(&vecx->PSG, 14);
 	switch (key)
 	{
-	case VECTREX_PAD1_BUTTON1: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x01 : psg_io | 0x01); break;
-	case VECTREX_PAD1_BUTTON2: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x02 : psg_io | 0x02); break;
-	case VECTREX_PAD1_BUTTON3: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x04 : psg_io | 0x04); break;
-	case VECTREX_PAD1_BUTTON4: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x08 : psg_io | 0x08); break;
+	case VECTREX_PAD1_BUTTON1: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x01 : psg_io | 0x01); break;
+	case VECTREX_PAD1_BUTTON2: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x02 : psg_io | 0x02); break;
+	case VECTREX_PAD1_BUTTON3: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x04 : psg_io | 0x04); break;
+	case VECTREX_PAD1_BUTTON4: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x08 : psg_io | 0x08); break;
 
-	case VECTREX_PAD2_BUTTON1: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x10 : psg_io | 0x10); break;
-	case VECTREX_PAD2_BUTTON2: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x20 : psg_io | 0x20); break;
-	case VECTREX_PAD2_BUTTON3: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x40 : psg_io | 0x40); break;
-	case VECTREX_PAD2_BUTTON4: e8910_write(&vecx->PSG, 14, value ? psg_io & ~0x80 : psg_io | 0x80); break;
+	case VECTREX_PAD2_BUTTON1: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x10 : psg_io | 0x10); break;
+	case VECTREX_PAD2_BUTTON2: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x20 : psg_io | 0x20); break;
+	case VECTREX_PAD2_BUTTON3: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x40 : psg_io | 0x40); break;
+	case VECTREX_PAD2_BUTTON4: e8910_write(&vecx->PSG, vecx->cycles, 14, value ? psg_io & ~0x80 : psg_io | 0x80); break;
 
 	case VECTREX_PAD1_X: vecx->DAC.jch0 = value; break;
 	case VECTREX_PAD1_Y: vecx->DAC.jch1 = value; break;
@@ -198,9 +229,12 @@ void vecx_reset(vecx *vecx)
     vecx->DAC.VIA = &vecx->VIA;
 
 	dac_reset(&vecx->DAC);
+	vecx_trace(vecx, vecx->trace);
 
-    vecx->vector_draw_cnt = 0;
+    vlist_clear(vecx->vectors);
     vecx->fcycles = FCYCLES_INIT;
+    vecx->cycles = 0;
+    vecx->frame_start = 0;
 
 	vecx->VIA.read8_port_a = read8_port_a;
     vecx->VIA.read8_port_b = read8_port_b;
@@ -223,11 +257,27 @@ void vecx_emu(vecx *vecx, int32_t cycles)
 	{
 		uint16_t icycles = e6809_sstep(&vecx->CPU, vecx->VIA.ifr & 0x80, 0);
 
-		for (uint16_t c = 0; c < icycles; c++)
+		if (vecx->trace == VECX_TRACE_OFF)
 		{
-			via_sstep0(&vecx->VIA);
-			dac_sstep(&vecx->DAC);
-			via_sstep1(&vecx->VIA);
+			for (uint16_t c = 0; c < icycles; c++)
+			{
+				via_sstep0(&vecx->VIA);
+				dac_sstep(&vecx->DAC);
+				via_sstep1(&vecx->VIA);
+			}
+
+			vecx->cycles += icycles;
+		}
+		else
+		{
+			/* tracing wants the beam time to the cycle */
+			for (uint16_t c = 0; c < icycles; c++)
+			{
+				via_sstep0(&vecx->VIA);
+				dac_sstep(&vecx->DAC);
+				via_sstep1(&vecx->VIA);
+				vecx->cycles++;
+			}
 		}
 
 		cycles -= (int32_t)icycles;
@@ -238,12 +288,33 @@ void vecx_emu(vecx *vecx, int32_t cycles)
 		{
 
             vecx->fcycles += FCYCLES_INIT;
+
+            vecx->vectors->start = vecx->frame_start;
+            vecx->vectors->cycles = vecx->cycles - vecx->frame_start;
+            vecx->frame_start = vecx->cycles;
+
             vecx->render();
 
 			/* everything that was drawn during this pass
 			 * now is being removed.
 			 */
-            vecx->vector_draw_cnt = 0;
+            vlist_clear(vecx->vectors);
 		}
 	}
 }
+
+void vecx_trace(vecx *vecx, uint8_t trace)
+{
+	vecx->trace = trace;
+
+	if (trace == VECX_TRACE_OFF)
+	{
+		vecx->DAC.add_line = addline;
+		vecx->DAC.start_line = NULL;
+	}
+	else
+	{
+		vecx->DAC.add_line = addline_traced;
+		vecx->DAC.start_line = startline;
+	}
+}
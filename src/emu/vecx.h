@@ -5,13 +5,14 @@
 #include "e6809.h"
 #include "e8910.h"
 #include "edac.h"
+#include "vlist.h"
 
 enum
 {
-	VECTREX_MHZ = 1500000, /* speed of the vectrex being emulated */
+	VECTREX_MHZ = VLIST_CPU_HZ, /* speed of the vectrex being emulated */
 	VECTREX_COLORS = 128,     /* number of possible colors ... grayscale */
 
-    VECTREX_PDECAY = 30,      /* phosphor decay rate */
+    VECTREX_PDECAY = VLIST_FRAME_RATE, /* phosphor decay rate */
 
     /* number of 6809 cycles before a frame redraw */
     FCYCLES_INIT = VECTREX_MHZ / VECTREX_PDECAY,
@@ -20,7 +21,7 @@ enum
     * one only needs VECTREX_MHZ / VECTREX_PDECAY but we need to also store
     * deleted vectors in a single table
     */
-    VECTOR_MAX_CNT = VECTREX_MHZ / VECTREX_PDECAY,
+    VECTOR_MAX_CNT = VLIST_MAX_CNT,
 
 	VECTREX_PAD1_BUTTON1 = 0,
 	VECTREX_PAD1_BUTTON2 = 1,
@@ -35,19 +36,12 @@ enum
 	VECTREX_PAD2_BUTTON4 = 9,
 	VECTREX_PAD2_X = 10,
 	VECTREX_PAD2_Y = 11,
-};
-
-typedef struct vector_type
-{
-	int32_t x0, y0; /* start coordinate */
-	int32_t x1, y1; /* end coordinate */
-
-				 /* color [0, VECTREX_COLORS - 1], if color = VECTREX_COLORS, then this is
-				 * an invalid entry and must be ignored.
-				 */
-	uint8_t color;
-} vector_t;
 
+	/* what vecx_trace records about each vector */
+	VECX_TRACE_OFF = 0,
+	VECX_TRACE_PC = 1,     /* program counter when the beam turned on */
+	VECX_TRACE_CALLER = 2  /* that plus the word on top of the stack */
+};
 
 typedef struct
 {
@@ -62,10 +56,24 @@ typedef struct
 
     int32_t fcycles;
 
+    /* 6809 cycles emulated since reset. advanced an instruction at a time,
+     * or every cycle while tracing.
+     */
+    uint32_t cycles;
+    uint32_t frame_start; /* cycles when the current frame started */
+
+    /* vector start tracing, see vecx_trace */
+    uint8_t trace;
+    uint16_t line_pc;
+    uint16_t line_caller;
+    uint32_t line_start;
+
     uint8_t snd_select;
 
-    size_t vector_draw_cnt;
-    vector_t vectors[VECTOR_MAX_CNT];
+    /* list the current frame is emitted into, provided by the frontend.
+     * render() may point it at a different list before it is cleared.
+     */
+    vlist *vectors;
 
     void(*render) (void);
 
@@ -75,4 +83,10 @@ void vecx_input(vecx *vecx, uint8_t key, uint8_t value);
 void vecx_reset(vecx *vecx);
 void vecx_emu(vecx *vecx, int32_t cycles);
 
+/* record where each vector came from in the vector list, one of the
+ * VECX_TRACE_ values. when off, which is the default, the dac is not even
+ * told to report vector starts. survives vecx_reset.
+ */
+void vecx_trace(vecx *vecx, uint8_t trace);
+
 #endif
@@ -0,0 +1,80 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "vlist.h"
+
+void vlist_clear(vlist *list)
+{
+	list->cnt = 0;
+	list->start = 0;
+	list->cycles = 0;
+	list->vert_cnt = 0;
+	list->traced = 0;
+}
+
+void vlist_add(vlist *list, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color, uint16_t t)
+{
+	size_t i = list->cnt;
+
+	if (i >= VLIST_MAX_CNT)
+	{
+		/* a frame overran its cycle budget, drop the vector */
+		return;
+	}
+
+	list->x0[i] = (uint16_t)x0;
+	list->y0[i] = (uint16_t)y0;
+	list->x1[i] = (uint16_t)x1;
+	list->y1[i] = (uint16_t)y1;
+	list->color[i] = color;
+	list->t[i] = t;
+	list->cnt = i + 1;
+
+	/* extend the current strip if the vector starts where the last one
+	 * ended, otherwise start a new strip with a blanked move.
+	 */
+	i = list->vert_cnt;
+
+	if (i == 0 || list->vx[i - 1] != (uint16_t)x0 || list->vy[i - 1] != (uint16_t)y0)
+	{
+		list->vx[i] = (uint16_t)x0;
+		list->vy[i] = (uint16_t)y0;
+		list->vcolor[i] = VLIST_MOVE;
+		i++;
+	}
+
+	list->vx[i] = (uint16_t)x1;
+	list->vy[i] = (uint16_t)y1;
+	list->vcolor[i] = color;
+	list->vert_cnt = i + 1;
+}
+
+void vlist_add_traced(vlist *list, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color, uint16_t t,
+	uint16_t pc, uint16_t caller, uint32_t beam)
+{
+	size_t i = list->cnt;
+
+	vlist_add(list, x0, y0, x1, y1, color, t);
+
+	if (list->cnt == i)
+		return;
+
+	list->pc[i] = pc;
+	list->caller[i] = caller;
+	list->beam[i] = beam > 0xffff ? 0xffff : (uint16_t)beam;
+	list->traced = 1;
+}
+
+void vlist_get(const vlist *list, size_t i, vector_t *v)
+{
+	v->x0 = list->x0[i];
+	v->y0 = list->y0[i];
+	v->x1 = list->x1[i];
+	v->y1 = list->y1[i];
+	v->color = list->color[i];
+}
+
+void vlist_put(vlist *list, const vector_t *v)
+{
+	vlist_add(list, v->x0, v->y0, v->x1, v->y1, v->color, 0);
+}
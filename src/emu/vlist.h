@@ -0,0 +1,102 @@
+#ifndef __VLIST_H
+#define __VLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum
+{
+	/* the 6809 clock and the frames per second the lists are sized for.
+	 * vecx.h includes this file and takes VECTREX_MHZ and VECTREX_PDECAY
+	 * from them, so the two cannot drift apart.
+	 */
+	VLIST_CPU_HZ = 1500000,
+	VLIST_FRAME_RATE = 30,
+
+	/* max number of vectors in a single frame. at most one vector can be
+	 * started per 6809 cycle and a frame lasts VECTREX_MHZ / VECTREX_PDECAY
+	 * cycles.
+	 */
+	VLIST_MAX_CNT = VLIST_CPU_HZ / VLIST_FRAME_RATE,
+
+	/* a strip vertex per vector end plus one per blanked move */
+	VLIST_MAX_VERTS = 2 * VLIST_MAX_CNT,
+
+	/* strip vertex color marking a blanked move, the beam jumps to the
+	 * vertex without drawing. same value as VECTREX_COLORS.
+	 */
+	VLIST_MOVE = 128
+};
+
+typedef struct vector_type
+{
+	int32_t x0, y0; /* start coordinate */
+	int32_t x1, y1; /* end coordinate */
+
+				 /* color [0, VECTREX_COLORS - 1], if color = VECTREX_COLORS, then this is
+				 * an invalid entry and must be ignored.
+				 */
+	uint8_t color;
+} vector_t;
+
+/* the vectors of a single frame stored as a structure of arrays.
+ *
+ * the dac only emits coordinates inside [0, DAC_MAX_X) x [0, DAC_MAX_Y) so
+ * they fit in 16 bits. DAC_MAX_Y is larger than INT16_MAX which is why the
+ * coordinates are unsigned.
+ *
+ * the same vectors are also kept as strips of shared vertices: games draw
+ * connected shapes where each vector starts at the end of the previous one,
+ * so each vertex only needs storing once. vertex i is joined to vertex i - 1
+ * by a segment of intensity vcolor[i], unless vcolor[i] is VLIST_MOVE in
+ * which case vertex i starts a new strip.
+ */
+typedef struct
+{
+	size_t cnt;
+
+	uint16_t x0[VLIST_MAX_CNT];
+	uint16_t y0[VLIST_MAX_CNT];
+	uint16_t x1[VLIST_MAX_CNT];
+	uint16_t y1[VLIST_MAX_CNT];
+	uint8_t color[VLIST_MAX_CNT];
+
+	/* when the frame started, in 6809 cycles since reset, and how long it
+	 * lasted. t is when each vector ended, in cycles since the frame
+	 * started. a list whose cycles are 0 has no timing, its vectors count
+	 * as drawn at the end of the frame.
+	 */
+	uint32_t start;
+	uint32_t cycles;
+	uint16_t t[VLIST_MAX_CNT];
+
+	size_t vert_cnt;
+
+	uint16_t vx[VLIST_MAX_VERTS];
+	uint16_t vy[VLIST_MAX_VERTS];
+	uint8_t vcolor[VLIST_MAX_VERTS];
+
+	/* where each vector came from, only filled in when the emulator traces
+	 * vector starts: the 6809 program counter when the beam turned on, the
+	 * word on top of the hardware stack at that point (usually the return
+	 * address into the caller of the drawing routine) and the 6809 cycles
+	 * the beam stayed on.
+	 */
+	int traced;
+	uint16_t pc[VLIST_MAX_CNT];
+	uint16_t caller[VLIST_MAX_CNT];
+	uint16_t beam[VLIST_MAX_CNT];
+} vlist;
+
+void vlist_clear(vlist *list);
+void vlist_add(vlist *list, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color, uint16_t t);
+
+/* vlist_add plus where the vector came from. beam saturates at 0xffff. */
+void vlist_add_traced(vlist *list, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color, uint16_t t,
+	uint16_t pc, uint16_t caller, uint32_t beam);
+
+/* adapters for code that works on vector_t */
+void vlist_get(const vlist *list, size_t i, vector_t *v);
+void vlist_put(vlist *list, const vector_t *v);
+
+#endif
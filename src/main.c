@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include <SDL.h>
 #include <SDL_image.h>
 
@@ -8,26 +9,119 @@
 #include "emu\e8910.h"
 #include "emu\e6522.h"
 #include "emu\edac.h"
+#include "emu\vlist.h"
 #include "emu\vecx.h"
 #include "ser.h"
+#include "vcapture.h"
+#include "vdiff.h"
+#include "vfilter.h"
+#include "vglow.h"
+#include "vgovern.h"
+#include "vhash.h"
+#include "vlod.h"
+#include "vprof.h"
+#include "vraster.h"
+#include "vstream.h"
+#include "vtarget.h"
+#include "vtrail.h"
+#include "vview.h"
+#include "vxchg.h"
 
 enum
 {
 	EMU_TIMER = 20, /* the emulators heart beats at 20 milliseconds */
 
 	DEFAULT_WIDTH = 495,
-	DEFAULT_HEIGHT = 615
+	DEFAULT_HEIGHT = 615,
+
+	/* identical frames needed before the persistence fill has faded out
+	 * everything else, alpha 128 halves the old image each frame. the
+	 * phosphor renderers derive theirs from tau, see settle_frames().
+	 */
+	STATIC_SETTLE_FRAMES = 8,
+
+	/* the overlay's alpha, applied to its pixels once when it is loaded */
+	OVERLAY_ALPHA = 128,
+
+	/* frames drawn before the first one --capture writes, so the phosphor
+	 * of the frames before it is there
+	 */
+	CAPTURE_WARMUP = 8
+};
+
+enum
+{
+	RENDER_LINES = 0,    /* one draw call per vector */
+	RENDER_STRIPS = 1,   /* one draw call per run of connected vectors */
+	RENDER_GEOMETRY = 2, /* one draw call per frame, needs SDL 2.0.18 */
+	RENDER_SOFTWARE = 3, /* own anti-aliased rasterizer, one upload per frame */
+	RENDER_BATCHED = 4   /* vectors sorted by intensity, a draw color each */
+};
+
+/* what the --govern levels give up, each level everything before it too */
+enum
+{
+	QUALITY_FULL = 0,
+	QUALITY_HALF_GLOW = 1, /* software glow reaches half as far */
+	QUALITY_NO_GLOW = 2,   /* no glow, no halo on the texture renderers */
+	QUALITY_LOD = 3,       /* collapse runs of sub-pixel vectors */
+	QUALITY_THIN = 4,      /* one pixel wide lines on the texture renderers */
+	QUALITY_COARSE = 5,    /* longer collapsed runs, dim vectors dropped */
+	QUALITY_LEVELS
+};
+
+/* requests from the event loop to the emulator */
+enum
+{
+	EMU_INPUT,
+	EMU_LOAD,
+	EMU_SAVE,
+	EMU_RESET,
+
+	EMU_CMD_MAX = 64
 };
 
+typedef struct
+{
+	int cmd;
+	uint8_t key;
+	uint8_t value;
+} emu_cmd;
+
 vecx vectrex;
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
-static SDL_Texture *overlay = NULL;
-static SDL_Texture *buffer = NULL;
-static SDL_Texture *buffer2 = NULL;
+static SDL_Texture *overlay = NULL; /* premultiplied unless overlay_straight */
+static char overlay_straight = 0;   /* no custom blend modes, overlay has straight alpha */
+static vtarget buffer;
+static vtarget buffer2;
+static vtarget soft_buffer;
+static vtarget overlay_buffer;     /* the overlay turned and scaled to the window */
+
+static vdiff frame_diff;
+static uint32_t static_settle = STATIC_SETTLE_FRAMES;
+static vfilter filter;
+static vlod lod;
+static vraster raster;
+static vglow glow;
+static vview view;
+static vcapture capture;
+static vtrail trail;
+static vgovern governor;
+static vstream_rec recorder;
+static vprof profile;
+static vhash_log hash_log;
+static vxchg frames;
 
-static int32_t scl_factor;
+/* with --threaded the emulator runs on its own thread and the main thread
+ * only handles events and renders.
+ */
+static SDL_Thread *emu_thread = NULL;
+static SDL_mutex *cmd_lock = NULL;
+static SDL_atomic_t emu_quit;
+static emu_cmd cmd_queue[EMU_CMD_MAX];
+static int cmd_cnt = 0;
 
 static void quit(void);
 
@@ -35,211 +129,1315 @@ static void quit(void);
 static char *bios_filename = "bios.bin";
 static char *cart_filename = NULL;
 static char *overlay_filename = NULL;
+static char *record_filename = NULL;
+static char *play_filename = NULL;
+static char *profile_filename = NULL;
+static char *hash_filename = NULL;
+static char *compare_filename[2] = { NULL, NULL };
+static char *capture_prefix = NULL;
+static char *state_filename = NULL;
+static uint32_t capture_first = 0;
+static uint32_t capture_frames = 1;
+static int hash_frames = 0;
+static int play_fps = 0;
 static char fullscreen = 0;
+static int render_mode = RENDER_LINES;
+static int raster_threads = 0;
+static int phosphor_ms = 0;
+static char upload_copy = 0;
+static char threaded = 0;
+static char vsync = 0;
+static int slices = 0;
+static char use_filter = 0;
+static char use_lod = 0;
+static char use_trail = 0;
+static float govern_ms = 0.0f;
+static char show_stats = 0;
 
-static void render(void)
+/* settings from the command line, the governor lowers quality from there */
+static struct
 {
-	SDL_SetRenderTarget(renderer, buffer);
+	char use_filter;
+	char use_lod;
+	uint8_t min_color;
+	uint32_t lod_max;
+	float glow_radius;
+	float glow_strength;
+} quality_base;
+
+static int quality = QUALITY_FULL;
+
+/* per frame statistics, summed up until they are printed */
+static struct
+{
+	uint32_t frames;
+	uint32_t vectors_in;
+	uint32_t vectors_culled;
+	uint32_t vectors_out;
+	uint32_t vectors_aged;    /* --trail vectors of older frames drawn */
+	uint32_t vectors_faded;   /* --trail vectors faded out */
+	uint32_t vectors_crowded; /* --trail vectors left out of a full list */
+	uint32_t state_changes; /* draw colors set */
+	uint32_t uploads;      /* software frames sent to the texture */
+	Uint64 upload_ticks;   /* time spent sending them */
+	uint32_t renders;      /* frames drawn rather than skipped */
+	Uint64 render_ticks;   /* time spent drawing them */
+	uint32_t presents;
+	uint32_t duplicated;   /* --vsync presents without a new frame */
+	uint32_t dropped;      /* vxchg.dropped at the last print */
+	uint32_t targets;      /* render targets allocated by resizes */
+} stats;
+
+static void set_draw_color(Uint8 alpha)
+{
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, alpha);
+	stats.state_changes++;
+}
+
+static void draw_lines(const vlist *list)
+{
+	int wide = quality < QUALITY_THIN;
+
+	for (size_t v = 0; v < list->cnt; v++)
 	{
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 128);
-		SDL_RenderFillRect(renderer, NULL);
+		Uint8 c = list->color[v] * 256 / VECTREX_COLORS;
+		int x0 = list->x0[v];
+		int y0 = list->y0[v];
+		int x1 = list->x1[v];
+		int y1 = list->y1[v];
 
-		for (size_t v = 0; v < vectrex.vector_draw_cnt; v++)
+		set_draw_color(c);
+		if (x0 == x1 && y0 == y1)
 		{
-			Uint8 c = vectrex.vectors[v].color * 256 / VECTREX_COLORS;
-			int x0 = vectrex.vectors[v].x0 / scl_factor;
-			int y0 = vectrex.vectors[v].y0 / scl_factor;
-			int x1 = vectrex.vectors[v].x1 / scl_factor;
-			int y1 = vectrex.vectors[v].y1 / scl_factor;
-
-			SDL_SetRenderDrawColor(renderer, 255, 255, 255, c);
-			if (x0 == x1 && y0 == y1)
+			/* point */
+			SDL_RenderDrawPoint(renderer, x0, y0);
+			if (wide)
 			{
-				/* point */
-				SDL_RenderDrawPoint(renderer, x0, y0);
 				SDL_RenderDrawPoint(renderer, x0 + 1, y0);
 				SDL_RenderDrawPoint(renderer, x0, y0 + 1);
 				SDL_RenderDrawPoint(renderer, x0 + 1, y0 + 1);
 			}
+		}
+		else
+		{
+			SDL_RenderDrawLine(renderer, x0, y0, x1, y1);
+			if (wide)
+				SDL_RenderDrawLine(renderer, x0 + 1, y0 + 1, x1 + 1, y1 + 1);
+		}
+	}
+}
+
+static SDL_Point strip_pts[VLIST_MAX_VERTS];
+static SDL_Point strip_pts2[VLIST_MAX_VERTS];
+
+/* draw strip_pts as connected lines in the current color */
+static void draw_polyline(int cnt)
+{
+	SDL_RenderDrawLines(renderer, strip_pts, cnt);
+
+	if (quality < QUALITY_THIN)
+	{
+		/* same one pixel diagonal offset copy as draw_lines */
+		for (int i = 0; i < cnt; i++)
+		{
+			strip_pts2[i].x = strip_pts[i].x + 1;
+			strip_pts2[i].y = strip_pts[i].y + 1;
+		}
+
+		SDL_RenderDrawLines(renderer, strip_pts2, cnt);
+	}
+}
+
+static void draw_strip_run(int cnt, uint8_t color)
+{
+	set_draw_color(color * 256 / VECTREX_COLORS);
+	draw_polyline(cnt);
+}
+
+static void draw_strips(const vlist *list)
+{
+	int cnt = 0;
+	uint8_t color = VLIST_MOVE;
+
+	/* a run is a part of a strip drawn with the same intensity. it ends at a
+	 * blanked move or at an intensity change, the last vertex of a run being
+	 * shared with the next one.
+	 */
+	for (size_t v = 0; v < list->vert_cnt; v++)
+	{
+		uint8_t vcolor = list->vcolor[v];
+
+		if (vcolor != color && cnt > 1)
+		{
+			draw_strip_run(cnt, color);
+			strip_pts[0] = strip_pts[cnt - 1];
+			cnt = 1;
+		}
+
+		if (vcolor == VLIST_MOVE)
+		{
+			cnt = 0;
+		}
+
+		strip_pts[cnt].x = list->vx[v];
+		strip_pts[cnt].y = list->vy[v];
+		cnt++;
+		color = vcolor;
+	}
+
+	if (cnt > 1)
+	{
+		draw_strip_run(cnt, color);
+	}
+}
+
+/* the frame's vectors bucketed by intensity, bucket c holds the indices
+ * from bucket_start[c] to bucket_start[c + 1]
+ */
+static uint32_t bucket_start[VECTREX_COLORS + 1];
+static uint32_t bucket_idx[VLIST_MAX_CNT];
+static SDL_Point batch_pts[4 * VLIST_MAX_CNT];
+
+static void draw_batched(const vlist *list)
+{
+	uint32_t pos = 0;
+
+	/* counting sort on the color, stable so vectors joined end to start
+	 * stay next to each other
+	 */
+	memset(bucket_start, 0, sizeof(bucket_start));
+
+	for (size_t v = 0; v < list->cnt; v++)
+		bucket_start[list->color[v]]++;
+
+	for (int c = 0; c <= VECTREX_COLORS; c++)
+	{
+		uint32_t n = c < VECTREX_COLORS ? bucket_start[c] : 0;
+		bucket_start[c] = pos;
+		pos += n;
+	}
+
+	for (size_t v = 0; v < list->cnt; v++)
+		bucket_idx[bucket_start[list->color[v]]++] = (uint32_t)v;
+
+	/* the scatter moved every start to the end of its bucket */
+	for (int c = VECTREX_COLORS; c > 0; c--)
+		bucket_start[c] = bucket_start[c - 1];
+	bucket_start[0] = 0;
+
+	/* color 0 is blank */
+	for (int c = 1; c < VECTREX_COLORS; c++)
+	{
+		int cnt = 0, pts = 0;
+
+		if (bucket_start[c] == bucket_start[c + 1])
+			continue;
+
+		set_draw_color(c * 256 / VECTREX_COLORS);
+
+		for (uint32_t i = bucket_start[c]; i < bucket_start[c + 1]; i++)
+		{
+			uint32_t v = bucket_idx[i];
+			int x0 = list->x0[v];
+			int y0 = list->y0[v];
+			int x1 = list->x1[v];
+			int y1 = list->y1[v];
+
+			if (x0 == x1 && y0 == y1)
+			{
+				/* the same point as draw_lines */
+				for (int p = 0; p < (quality < QUALITY_THIN ? 4 : 1); p++)
+				{
+					batch_pts[pts].x = x0 + (p & 1);
+					batch_pts[pts].y = y0 + (p >> 1);
+					pts++;
+				}
+				continue;
+			}
+
+			/* lines join into one polyline while each starts where the
+			 * last one ended
+			 */
+			if (cnt > 0 && (strip_pts[cnt - 1].x != x0 || strip_pts[cnt - 1].y != y0))
+			{
+				draw_polyline(cnt);
+				cnt = 0;
+			}
+
+			if (cnt == 0)
+			{
+				strip_pts[0].x = x0;
+				strip_pts[0].y = y0;
+				cnt = 1;
+			}
+
+			strip_pts[cnt].x = x1;
+			strip_pts[cnt].y = y1;
+			cnt++;
+		}
+
+		if (cnt > 1)
+			draw_polyline(cnt);
+		if (pts > 0)
+			SDL_RenderDrawPoints(renderer, batch_pts, pts);
+	}
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+static SDL_Vertex geom_verts[4 * VLIST_MAX_CNT];
+static int geom_index[6 * VLIST_MAX_CNT];
+
+/* every vector becomes a quad two pixels wide, extended by a pixel past
+ * both ends so points come out as squares like in draw_lines. the whole
+ * frame is submitted at once. the list is in dac units, positions keep
+ * their fraction of a pixel.
+ */
+static void draw_geometry(const vlist *list)
+{
+	static int index_init = 0;
+	const vview_xform *m = &view.xform;
+	float half = quality < QUALITY_THIN ? 1.0f : 0.5f; /* half the line width */
+	size_t cnt = list->cnt;
+
+	if (!index_init)
+	{
+		for (int q = 0; q < VLIST_MAX_CNT; q++)
+		{
+			int *i = &geom_index[6 * q];
+			i[0] = 4 * q;
+			i[1] = 4 * q + 1;
+			i[2] = 4 * q + 2;
+			i[3] = 4 * q + 2;
+			i[4] = 4 * q + 3;
+			i[5] = 4 * q;
+		}
+
+		index_init = 1;
+	}
+
+	for (size_t v = 0; v < cnt; v++)
+	{
+		SDL_Vertex *q = &geom_verts[4 * v];
+		SDL_Color c = { 255, 255, 255, (Uint8)(list->color[v] * 256 / VECTREX_COLORS) };
+
+		/* draw_lines fills pixels x and x + 1, centered on x + 1 */
+		float x0 = m->ax * list->x0[v] + m->bx * list->y0[v] + m->cx + 1.0f;
+		float y0 = m->ay * list->x0[v] + m->by * list->y0[v] + m->cy + 1.0f;
+		float x1 = m->ax * list->x1[v] + m->bx * list->y1[v] + m->cx + 1.0f;
+		float y1 = m->ay * list->x1[v] + m->by * list->y1[v] + m->cy + 1.0f;
+		float dx = x1 - x0;
+		float dy = y1 - y0;
+		float len = SDL_sqrtf(dx * dx + dy * dy);
+
+		if (len < 0.5f)
+		{
+			dx = half;
+			dy = 0.0f;
+		}
+		else
+		{
+			dx *= half / len;
+			dy *= half / len;
+		}
+
+		/* along the vector and across it, half the width each */
+		q[0].position.x = x0 - dx - dy;
+		q[0].position.y = y0 - dy + dx;
+		q[1].position.x = x1 + dx - dy;
+		q[1].position.y = y1 + dy + dx;
+		q[2].position.x = x1 + dx + dy;
+		q[2].position.y = y1 + dy - dx;
+		q[3].position.x = x0 - dx + dy;
+		q[3].position.y = y0 - dy - dx;
+
+		for (int i = 0; i < 4; i++)
+		{
+			q[i].color = c;
+			q[i].tex_coord.x = 0.0f;
+			q[i].tex_coord.y = 0.0f;
+		}
+	}
+
+	if (cnt > 0)
+		SDL_RenderGeometry(renderer, NULL, geom_verts, (int)(4 * cnt), geom_index, (int)(6 * cnt));
+}
+#endif
+
+/* rasterize on the cpu and upload the result. vectors before first are
+ * already drawn.
+ */
+static void draw_software(const vlist *list, size_t first)
+{
+	void *pixels;
+	int pitch;
+	Uint64 t0 = SDL_GetPerformanceCounter();
+
+	if (!upload_copy && SDL_LockTexture(soft_buffer.tex, &soft_buffer.rect, &pixels, &pitch) == 0)
+	{
+		/* the locked pixels are written once and never read, they can be
+		 * slow to read back. with glow the raster resolves into its own
+		 * pixels and the glow writes the result, without it the raster
+		 * resolves straight into the texture. only locking and unlocking
+		 * count as upload.
+		 */
+		Uint64 t1 = SDL_GetPerformanceCounter();
+
+		if (vglow_active(&glow))
+		{
+			vraster_slice(&raster, list, first, NULL, 0);
+			vglow_apply(&glow, raster.pixels, raster.width, pixels, pitch / (int)sizeof(uint32_t));
+		}
+		else
+		{
+			vraster_slice(&raster, list, first, pixels, pitch / (int)sizeof(uint32_t));
+		}
+
+		t0 += SDL_GetPerformanceCounter() - t1;
+		SDL_UnlockTexture(soft_buffer.tex);
+	}
+	else
+	{
+		vraster_slice(&raster, list, first, NULL, 0);
+		vglow_apply(&glow, raster.pixels, raster.width, raster.pixels, raster.width);
+
+		t0 = SDL_GetPerformanceCounter();
+		SDL_UpdateTexture(soft_buffer.tex, &soft_buffer.rect, raster.pixels, raster.width * (int)sizeof(uint32_t));
+	}
+
+	stats.uploads++;
+	stats.upload_ticks += SDL_GetPerformanceCounter() - t0;
+}
+
+static void print_stats(void)
+{
+	uint32_t n = stats.frames;
+	uint32_t dropped;
+
+	if (n < VECTREX_PDECAY)
+		return;
+
+	/* the emulator thread counts these with --threaded */
+	dropped = (uint32_t)SDL_AtomicGet(&frames.dropped);
+
+	printf("frames %u, vectors/frame in %u culled %u out %u\n",
+		n, stats.vectors_in / n, stats.vectors_culled / n, stats.vectors_out / n);
+
+	if (use_trail)
+	{
+		printf("trail vectors/frame aged %u faded %u crowded %u\n",
+			stats.vectors_aged / n, stats.vectors_faded / n, stats.vectors_crowded / n);
+	}
+
+	if (stats.state_changes > 0)
+		printf("draw color changes/frame %u\n", stats.state_changes / n);
+
+	if (stats.renders > 0)
+	{
+		printf("render %.3f ms/frame, quality level %d\n",
+			stats.render_ticks * 1000.0 / SDL_GetPerformanceFrequency() / stats.renders, quality);
+	}
+
+	if (vsync)
+	{
+		printf("presents %u, frames dropped %u duplicated %u\n",
+			stats.presents, dropped - stats.dropped, stats.duplicated);
+	}
+
+	if (stats.uploads > 0)
+	{
+		printf("upload %s %.3f ms/frame\n", upload_copy ? "copy" : "lock",
+			stats.upload_ticks * 1000.0 / SDL_GetPerformanceFrequency() / stats.uploads);
+	}
+
+	if (stats.targets > 0)
+		printf("render targets allocated %u\n", stats.targets);
+
+	memset(&stats, 0, sizeof(stats));
+	stats.dropped = dropped;
+}
+
+/* the texture holding the last frame drawn and its half size halo, the
+ * software renderer has its glow in the frame already
+ */
+static vtarget *frame_texture(void)
+{
+	return render_mode == RENDER_SOFTWARE ? &soft_buffer : &buffer;
+}
+
+static vtarget *halo_texture(void)
+{
+	return render_mode == RENDER_SOFTWARE || quality >= QUALITY_NO_GLOW ? NULL : &buffer2;
+}
+
+/* show the last frame drawn with the overlay on top */
+static void present(void)
+{
+	vtarget *frame = frame_texture();
+	vtarget *halo = halo_texture();
+
+	SDL_SetRenderTarget(renderer, NULL);
+	{
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+
+		SDL_RenderCopy(renderer, frame->tex, &frame->rect, NULL);
+		if (halo)
+			SDL_RenderCopy(renderer, halo->tex, &halo->rect, NULL);
+
+		/* already at the window size, a plain copy */
+		if (overlay)
+			SDL_RenderCopy(renderer, overlay_buffer.tex, &overlay_buffer.rect, NULL);
+	}
+	SDL_RenderPresent(renderer);
+
+	stats.presents++;
+}
+
+/* apply a governor quality level on top of the settings from the command
+ * line
+ */
+static void set_quality(int level)
+{
+	const int coarse = level >= QUALITY_COARSE;
+
+	quality = level;
+
+	glow.config.radius = quality_base.glow_radius / (level >= QUALITY_HALF_GLOW ? 2 : 1);
+	glow.config.strength = level >= QUALITY_NO_GLOW ? 0.0f : quality_base.glow_strength;
+
+	use_lod = quality_base.use_lod || level >= QUALITY_LOD;
+	lod.config.max_len = quality_base.lod_max * (coarse ? 4 : 1);
+
+	use_filter = quality_base.use_filter || coarse;
+	filter.config.min_color = coarse && quality_base.min_color < 16 ? 16 : quality_base.min_color;
+}
+
+/* count the time since t0 as render time and feed it to the governor,
+ * which may change the quality for the next frame
+ */
+static void govern(Uint64 t0)
+{
+	Uint64 t = SDL_GetPerformanceCounter() - t0;
+	int level;
+
+	stats.renders++;
+	stats.render_ticks += t;
+
+	if (govern_ms <= 0.0f)
+		return;
+
+	level = vgovern_frame(&governor, (float)(t * 1000.0 / SDL_GetPerformanceFrequency()));
+	if (level != quality)
+		set_quality(level);
+}
+
+/* identical frames until the last image has decayed below one step of
+ * 255, exp(-n / (VECTREX_PDECAY * tau)) < 1 / 255. the line renderers
+ * fade with a fixed fill unless --trail hands the decay to its tau.
+ */
+static uint32_t settle_frames(void)
+{
+	float tau;
+	uint32_t n;
+
+	if (render_mode == RENDER_SOFTWARE)
+		tau = raster.config.tau;
+	else if (use_trail)
+		tau = trail.config.tau;
+	else
+		return STATIC_SETTLE_FRAMES;
+
+	n = (uint32_t)ceilf(VECTREX_PDECAY * tau * logf(255.0f));
+	return n > STATIC_SETTLE_FRAMES ? n : STATIC_SETTLE_FRAMES;
+}
+
+/* draw a frame and present it. returns 0 if the frame was skipped because
+ * the window already shows it.
+ */
+static int render(const vlist *list)
+{
+	vtarget *frame = frame_texture();
+	vtarget *halo = halo_texture();
+	Uint64 t0 = SDL_GetPerformanceCounter();
+
+	stats.frames++;
+	stats.vectors_in += (uint32_t)list->cnt;
+
+	if (use_filter)
+	{
+		list = vfilter_run(&filter, list);
+		stats.vectors_culled += filter.stats.in - filter.stats.out;
+	}
+
+	if (use_lod)
+	{
+		list = vlod_run(&lod, list);
+		stats.vectors_culled += lod.stats.collapsed;
+	}
+
+	if (use_trail)
+	{
+		list = vtrail_run(&trail, list);
+		stats.vectors_aged += trail.stats.aged;
+		stats.vectors_faded += trail.stats.faded;
+		stats.vectors_crowded += trail.stats.crowded;
+	}
+
+	stats.vectors_out += (uint32_t)list->cnt;
+
+	if (show_stats)
+		print_stats();
+
+	/* once a static screen has settled the window already shows it, skip
+	 * rendering and presenting altogether. --play times every frame, a
+	 * skipped one would count as free.
+	 */
+	if (!play_filename && vdiff_update(&frame_diff, list) &&
+		frame_diff.unchanged >= static_settle)
+	{
+		return 0;
+	}
+
+	if (render_mode == RENDER_SOFTWARE)
+	{
+		draw_software(list, 0);
+	}
+	else
+	{
+		/* the geometry renderer transforms its own vertices, the others
+		 * draw whole pixels
+		 */
+		if (render_mode != RENDER_GEOMETRY)
+			list = vview_run(&view, list);
+
+		SDL_SetRenderTarget(renderer, buffer.tex);
+		{
+			/* with --trail the older frames are in the list, the
+			 * buffer starts over
+			 */
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, use_trail ? 255 : 128);
+			SDL_RenderFillRect(renderer, NULL);
+
+			switch (render_mode)
+			{
+			case RENDER_LINES:
+				draw_lines(list);
+				break;
+			case RENDER_STRIPS:
+				draw_strips(list);
+				break;
+			case RENDER_BATCHED:
+				draw_batched(list);
+				break;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+			case RENDER_GEOMETRY:
+				draw_geometry(list);
+				break;
+#endif
+			}
+		}
+	}
+
+	if (halo)
+	{
+		SDL_SetRenderTarget(renderer, halo->tex);
+		SDL_RenderCopy(renderer, frame->tex, &frame->rect, &halo->rect);
+	}
+
+	if (vsync)
+	{
+		/* presenting waits for the display, that is not render time */
+		govern(t0);
+		present();
+	}
+	else
+	{
+		/* the present is where the gpu work gets paid for */
+		present();
+		govern(t0);
+	}
+
+	return 1;
+}
+
+/* with --slices the frame being emitted is shown as it goes. the vectors
+ * since the last slice are drawn over the phosphor buffer, which has decayed
+ * up to the time of the slice.
+ */
+static size_t slice_drawn = 0; /* vectors of the frame already on screen */
+
+static void render_slice(const vlist *list, int show)
+{
+	if (list->cycles > 0)
+	{
+		draw_software(list, slice_drawn);
+		slice_drawn = list->cnt;
+	}
+
+	if (show)
+		present();
+}
+
+static void log_hash(void)
+{
+	vhash_write(&hash_log, vhash_frame(&vectrex, vectrex.vectors));
+}
+
+/* called by the emulator at the end of every frame */
+static void publish(void)
+{
+	vstream_rec_frame(&recorder, vectrex.vectors);
+
+	if (profile_filename)
+		vprof_frame(&profile, vectrex.vectors);
+
+	if (hash_filename)
+		log_hash();
+
+	if (slices > 0)
+	{
+		/* the rest of the frame before the list goes, the next slice
+		 * shows it
+		 */
+		render_slice(vectrex.vectors, 0);
+		slice_drawn = 0;
+	}
+
+	vectrex.vectors = vxchg_publish(&frames);
+
+	if (!threaded && !vsync && !slices)
+	{
+		render(vxchg_acquire(&frames));
+	}
+}
+
+static void load_bios(void)
+{
+	FILE *f;
+	if (!(f = fopen(bios_filename, "rb")))
+	{
+		perror(bios_filename);
+		quit();
+	}
+	if (fread(vectrex.rom, 1, sizeof(vectrex.rom), f) != sizeof(vectrex.rom))
+	{
+		fprintf(stderr, "Invalid bios length\n");
+		quit();
+	}
+	fclose(f);
+}
+
+static void load_cart(void)
+{
+	memset(vectrex.cart, 0, sizeof(vectrex.cart));
+	if (cart_filename)
+	{
+		FILE *f;
+		if (!(f = fopen(cart_filename, "rb")))
+		{
+			perror(cart_filename);
+			return;
+		}
+		fread(vectrex.cart, 1, sizeof(vectrex.cart), f);
+		fclose(f);
+	}
+}
+
+/* fit a target to the window, counting the allocations */
+static int size_target(vtarget *t, int width, int height)
+{
+	int r = vtarget_size(t, renderer, width, height);
+
+	if (r < 0)
+	{
+		fprintf(stderr, "Failed to create render target: %s\n", SDL_GetError());
+		quit();
+	}
+
+	stats.targets += r;
+	return r;
+}
+
+/* src + dst * (1 - src alpha), for colors with their alpha multiplied in */
+static SDL_BlendMode premultiplied_blend(void)
+{
+	return SDL_ComposeCustomBlendMode(
+		SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+		SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+/* scale and turn the overlay to the window once, so presenting only copies
+ * it. the overlay is premultiplied where the renderer can blend that,
+ * filtering it while scaling does not bleed the color of transparent
+ * pixels into the edges.
+ */
+static void compose_overlay(void)
+{
+	SDL_Rect dst = { view.x, view.y, view.w, view.h };
+
+	if (!overlay)
+		return;
+
+	if (size_target(&overlay_buffer, view.width, view.height) > 0 &&
+		(overlay_straight || SDL_SetTextureBlendMode(overlay_buffer.tex, premultiplied_blend()) < 0))
+	{
+		SDL_SetTextureBlendMode(overlay_buffer.tex, SDL_BLENDMODE_BLEND);
+	}
+
+	/* the overlay is drawn upright, turned with the picture. an odd number
+	 * of turns swaps its sides around the same center
+	 */
+	if (view.config.rotate & 1)
+	{
+		dst.x += (view.w - view.h) / 2;
+		dst.y += (view.h - view.w) / 2;
+		dst.w = view.h;
+		dst.h = view.w;
+	}
+
+	/* all of the target, a smaller window leaves the old picture outside
+	 * the part in use
+	 */
+	SDL_SetRenderTarget(renderer, overlay_buffer.tex);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	SDL_RenderClear(renderer);
+	SDL_RenderCopyEx(renderer, overlay, NULL, &dst, 90.0 * view.config.rotate, NULL, SDL_FLIP_NONE);
+	SDL_SetRenderTarget(renderer, NULL);
+}
+
+/* everything is drawn at the window size, the view places the picture.
+ * the targets only get allocated again when the size class changes, a
+ * drag resize mostly reuses them.
+ */
+static void resize(void)
+{
+	int width, height;
+
+	SDL_GetWindowSize(window, &width, &height);
+	vview_resize(&view, width, height);
+
+	size_target(&buffer, width, height);
+
+	if (size_target(&buffer2, width / 2, height / 2))
+	{
+		SDL_SetTextureBlendMode(buffer2.tex, SDL_BLENDMODE_BLEND);
+		SDL_SetTextureAlphaMod(buffer2.tex, 128);
+	}
+
+	compose_overlay();
+
+	if (render_mode == RENDER_SOFTWARE)
+	{
+		size_target(&soft_buffer, width, height);
+
+		if (!vraster_resize(&raster, width, height) || !vglow_resize(&glow, width, height))
+		{
+			fprintf(stderr, "Failed to allocate raster buffers\n");
+			quit();
+		}
+
+		raster.config.xform = view.xform;
+	}
+
+	lod.config.quant = view.quant;
+	vdiff_reset(&frame_diff, view.quant);
+}
+
+static void run_cmd(const emu_cmd *c)
+{
+	switch (c->cmd)
+	{
+	case EMU_INPUT: vecx_input(&vectrex, c->key, c->value); break;
+	case EMU_LOAD: vecx_load(&vectrex, "q.save"); break;
+	case EMU_SAVE: vecx_save(&vectrex, "q.save"); break;
+	case EMU_RESET: load_cart(); vecx_reset(&vectrex); break;
+	}
+}
+
+/* run a request on the emulator, or queue it for the emulation thread */
+static void emu_post(int cmd, uint8_t key, uint8_t value)
+{
+	emu_cmd *c;
+
+	/* --play renders a recording, there is no emulator to take input,
+	 * resets or states
+	 */
+	if (play_filename)
+		return;
+
+	if (!threaded)
+	{
+		emu_cmd now;
+		now.cmd = cmd;
+		now.key = key;
+		now.value = value;
+		run_cmd(&now);
+		return;
+	}
+
+	SDL_LockMutex(cmd_lock);
+	if (cmd_cnt < EMU_CMD_MAX)
+	{
+		c = &cmd_queue[cmd_cnt++];
+		c->cmd = cmd;
+		c->key = key;
+		c->value = value;
+	}
+	SDL_UnlockMutex(cmd_lock);
+}
+
+static void run_cmds(void)
+{
+	emu_cmd cmds[EMU_CMD_MAX];
+	int cnt;
+
+	SDL_LockMutex(cmd_lock);
+	cnt = cmd_cnt;
+	memcpy(cmds, cmd_queue, cnt * sizeof(emu_cmd));
+	cmd_cnt = 0;
+	SDL_UnlockMutex(cmd_lock);
+
+	for (int i = 0; i < cnt; i++)
+		run_cmd(&cmds[i]);
+}
+
+static int readevents(void)
+{
+	SDL_Event e;
+	while (SDL_PollEvent(&e))
+	{
+		switch (e.type)
+		{
+		case SDL_QUIT:
+			return 1;
+			break;
+		case SDL_WINDOWEVENT:
+			if (e.window.event == SDL_WINDOWEVENT_RESIZED)
+				resize();
+			else if (e.window.event == SDL_WINDOWEVENT_EXPOSED)
+				vdiff_reset(&frame_diff, view.quant);
+			break;
+		case SDL_RENDER_TARGETS_RESET:
+			/* the driver lost what was drawn into the targets */
+			compose_overlay();
+			vdiff_reset(&frame_diff, view.quant);
+			break;
+		case SDL_DROPFILE:
+			cart_filename = e.drop.file;
+			emu_post(EMU_RESET, 0, 0);
+			break;
+		case SDL_KEYDOWN:
+			switch (e.key.keysym.sym)
+			{
+			case SDLK_ESCAPE: return 1;
+			case SDLK_a: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON1, 1); break;
+			case SDLK_s: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON2, 1); break;
+			case SDLK_d: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON3, 1); break;
+			case SDLK_f: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON4, 1); break;
+			case SDLK_LEFT: emu_post(EMU_INPUT, VECTREX_PAD1_X, 0x00); break;
+			case SDLK_RIGHT: emu_post(EMU_INPUT, VECTREX_PAD1_X, 0xff); break;
+			case SDLK_UP: emu_post(EMU_INPUT, VECTREX_PAD1_Y, 0xff); break;
+			case SDLK_DOWN: emu_post(EMU_INPUT, VECTREX_PAD1_Y, 0x00); break;
+			}
+			break;
+		case SDL_KEYUP:
+			switch (e.key.keysym.sym)
+			{
+			case SDLK_F1: emu_post(EMU_LOAD, 0, 0); break;
+			case SDLK_F2: emu_post(EMU_SAVE, 0, 0); break;
+			case SDLK_r: emu_post(EMU_RESET, 0, 0); break;
+
+			case SDLK_a: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON1, 0); break;
+			case SDLK_s: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON2, 0); break;
+			case SDLK_d: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON3, 0); break;
+			case SDLK_f: emu_post(EMU_INPUT, VECTREX_PAD1_BUTTON4, 0); break;
+			case SDLK_LEFT: emu_post(EMU_INPUT, VECTREX_PAD1_X, 0x80); break;
+			case SDLK_RIGHT: emu_post(EMU_INPUT, VECTREX_PAD1_X, 0x80); break;
+			case SDLK_UP: emu_post(EMU_INPUT, VECTREX_PAD1_Y, 0x80); break;
+			case SDLK_DOWN: emu_post(EMU_INPUT, VECTREX_PAD1_Y, 0x80); break;
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
+static void emu_wait(Uint32 *next_time)
+{
+	Uint32 now = SDL_GetTicks();
+	if (now < *next_time)
+		SDL_Delay(*next_time - now);
+	else
+		*next_time = now;
+	*next_time += EMU_TIMER;
+}
+
+static int emuthread(void *data)
+{
+	Uint32 next_time = SDL_GetTicks() + EMU_TIMER;
+	(void)data;
+
+	while (!SDL_AtomicGet(&emu_quit))
+	{
+		run_cmds();
+		vecx_emu(&vectrex, (VECTREX_MHZ / 1000) * EMU_TIMER);
+		emu_wait(&next_time);
+	}
+
+	return 0;
+}
+
+/* present once per display refresh. before each present the emulator runs
+ * the cycles owed for the wall clock time since the last one, then the
+ * newest finished frame is drawn. a refresh without a new frame shows the
+ * last one again.
+ *
+ * with --slices presents come that many times a frame instead and show the
+ * frame being emitted so far.
+ */
+static void vsyncloop(void)
+{
+	Uint64 freq = SDL_GetPerformanceFrequency();
+	Uint64 period = freq / 60;
+	Uint64 last = SDL_GetPerformanceCounter();
+	double owed = 0.0;
+	SDL_DisplayMode mode;
+
+	if (slices > 0)
+		period = freq / (VECTREX_PDECAY * slices);
+	else if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 && mode.refresh_rate > 0)
+		period = freq / mode.refresh_rate;
+
+	while (!readevents())
+	{
+		Uint64 now = SDL_GetPerformanceCounter();
+		uint32_t start = vectrex.cycles;
+		vlist *list;
+
+		owed += (double)(now - last) * VECTREX_MHZ / freq;
+		last = now;
+
+		/* after a stall, like a window being dragged, give up on the time
+		 * lost rather than racing to catch up
+		 */
+		if (owed > VECTREX_MHZ / 10)
+			owed = VECTREX_MHZ / 10;
+
+		if (owed >= 1.0)
+			vecx_emu(&vectrex, (int32_t)owed);
+
+		/* instructions overrun the budget a little, it comes off the next */
+		owed -= (uint32_t)(vectrex.cycles - start);
+
+		if (slices > 0)
+		{
+			/* frames that ended meanwhile were finished by publish */
+			list = vectrex.vectors;
+			list->start = vectrex.frame_start;
+			list->cycles = vectrex.cycles - vectrex.frame_start;
+			render_slice(list, 1);
+		}
+		else
+		{
+			list = vxchg_acquire(&frames);
+			if (!list)
+				stats.duplicated++;
+			if (!list || !render(list))
+				present();
+		}
+
+		/* the driver may not wait for vsync, then pace by the clock */
+		now = SDL_GetPerformanceCounter() - now;
+		if (now < (vsync ? period / 2 : period))
+			SDL_Delay((Uint32)((period - now) * 1000 / freq));
+	}
+}
+
+static void emuloop(void)
+{
+	Uint32 next_time = SDL_GetTicks() + EMU_TIMER;
+	vectrex.vectors = vxchg_back(&frames);
+	vecx_reset(&vectrex);
+
+	if (vsync || slices > 0)
+	{
+		vsyncloop();
+		return;
+	}
+
+	if (threaded)
+	{
+		/* the emulator keeps its own pace, draw whatever frame it finished
+		 * last and never block it.
+		 */
+		emu_thread = SDL_CreateThread(emuthread, "emu", NULL);
+		if (!emu_thread)
+		{
+			fprintf(stderr, "Failed to create emulation thread: %s\n", SDL_GetError());
+			return;
+		}
+
+		while (!readevents())
+		{
+			vlist *list = vxchg_acquire(&frames);
+			if (list)
+				render(list);
+			else
+				SDL_Delay(1);
+		}
+
+		SDL_AtomicSet(&emu_quit, 1);
+		SDL_WaitThread(emu_thread, NULL);
+		return;
+	}
+
+	for (;;)
+	{
+		vecx_emu(&vectrex, (VECTREX_MHZ / 1000) * EMU_TIMER);
+		if (readevents()) break;
+
+		emu_wait(&next_time);
+	}
+}
+
+/* emulate --hash-frames frames as fast as possible, without a window or
+ * audio, only logging their hashes.
+ */
+static void hashloop(void)
+{
+	vlist *list = malloc(sizeof(vlist));
+
+	if (!list)
+		return;
+
+	load_bios();
+	load_cart();
+
+	vectrex.vectors = list;
+	vectrex.render = log_hash;
+	vecx_reset(&vectrex);
+
+	while (hash_log.frames < (uint32_t)hash_frames)
+		vecx_emu(&vectrex, FCYCLES_INIT);
+
+	free(list);
+}
+
+static int cmp_ticks(const void *a, const void *b)
+{
+	Uint64 x = *(const Uint64 *)a;
+	Uint64 y = *(const Uint64 *)b;
+	return x < y ? -1 : x > y;
+}
+
+/* feed a recorded stream through render() and measure how fast it goes */
+static void playloop(void)
+{
+	vstream_reader rd;
+	vlist *list;
+	Uint64 freq = SDL_GetPerformanceFrequency();
+	Uint64 start, next, elapsed;
+	Uint64 *lat = NULL;
+	size_t lat_cnt = 0, lat_max = 0;
+	uint64_t vectors = 0;
+
+	if (!vstream_read_open(&rd, play_filename))
+		return;
+
+	/* frames are rendered straight from the reader, not from the emulator */
+	list = vxchg_back(&frames);
+
+	start = next = SDL_GetPerformanceCounter();
+
+	while (!readevents() && vstream_read_frame(&rd, list))
+	{
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		render(list);
+
+		if (lat_cnt == lat_max)
+		{
+			size_t max = lat_max ? lat_max * 2 : 1024;
+			Uint64 *l = realloc(lat, max * sizeof(Uint64));
+			if (!l)
+				break;
+			lat = l;
+			lat_max = max;
+		}
+		lat[lat_cnt++] = SDL_GetPerformanceCounter() - t0;
+		vectors += list->cnt;
+
+		if (play_fps > 0)
+		{
+			Uint64 now = SDL_GetPerformanceCounter();
+			next += freq / play_fps;
+			if (now < next)
+				SDL_Delay((Uint32)((next - now) * 1000 / freq));
 			else
-			{
-				SDL_RenderDrawLine(renderer, x0, y0, x1, y1);
-				SDL_RenderDrawLine(renderer, x0 + 1, y0 + 1, x1 + 1, y1 + 1);
-			}
+				next = now;
 		}
 	}
 
-	SDL_SetRenderTarget(renderer, buffer2);
-	{
-		SDL_RenderCopy(renderer, buffer, NULL, NULL);
-	}
+	elapsed = SDL_GetPerformanceCounter() - start;
+	vstream_read_close(&rd);
 
-	SDL_SetRenderTarget(renderer, NULL);
+	if (lat_cnt > 0 && elapsed > 0)
 	{
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
+		double secs = (double)elapsed / freq;
+		double ms = 1000.0 / freq;
 
-		SDL_RenderCopy(renderer, buffer, NULL, NULL);
-		SDL_RenderCopy(renderer, buffer2, NULL, NULL);
+		qsort(lat, lat_cnt, sizeof(Uint64), cmp_ticks);
 
-		if (overlay)
-		{
-			SDL_RenderCopy(renderer, overlay, NULL, NULL);
-		}
+		printf("%u frames in %.2f s: %.1f frames/s, %.0f vectors/s\n",
+			(unsigned)lat_cnt, secs, lat_cnt / secs, vectors / secs);
+		printf("render latency ms: p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+			lat[lat_cnt / 2] * ms, lat[lat_cnt * 9 / 10] * ms,
+			lat[lat_cnt * 99 / 100] * ms, lat[lat_cnt - 1] * ms);
 	}
-	SDL_RenderPresent(renderer);
+
+	free(lat);
 }
 
-static void load_bios(void)
+/* the emulator's frames while capturing */
+static uint32_t capture_frame = 0;
+
+static void capture_publish(void)
 {
-	FILE *f;
-	if (!(f = fopen(bios_filename, "rb")))
-	{
-		perror(bios_filename);
-		quit();
-	}
-	if (fread(vectrex.rom, 1, sizeof(vectrex.rom), f) != sizeof(vectrex.rom))
-	{
-		fprintf(stderr, "Invalid bios length\n");
-		quit();
-	}
-	fclose(f);
+	if (capture_frame + CAPTURE_WARMUP >= capture_first)
+		vcapture_draw(&capture, vectrex.vectors, capture_frame, capture_frame >= capture_first);
+
+	capture_frame++;
 }
 
-static void load_cart(void)
+/* render frames to files, from a recorded stream or from the emulator */
+static void captureloop(void)
 {
-	memset(vectrex.cart, 0, sizeof(vectrex.cart));
-	if (cart_filename)
+	uint32_t end = capture_first + capture_frames;
+	uint32_t warm = capture_first > CAPTURE_WARMUP ? capture_first - CAPTURE_WARMUP : 0;
+	vlist *list = malloc(sizeof(vlist));
+
+	/* the glow reaches as far relative to the picture as in the window */
+	capture.config.glow = glow.config;
+	capture.config.glow.radius *= (float)capture.config.height / DEFAULT_HEIGHT;
+	capture.config.view = view.config;
+	capture.config.threads = raster_threads;
+	capture.config.tau = phosphor_ms / 1000.0f;
+	capture.config.lod = use_lod;
+	capture.config.lod_max = lod.config.max_len;
+
+	if (!list || !vcapture_open(&capture, capture_prefix))
 	{
-		FILE *f;
-		if (!(f = fopen(cart_filename, "rb")))
+		fprintf(stderr, "Failed to start capture to %s\n", capture_prefix);
+		free(list);
+		return;
+	}
+
+	if (play_filename)
+	{
+		vstream_reader rd;
+
+		if (vstream_read_open(&rd, play_filename))
 		{
-			perror(cart_filename);
-			return;
+			vstream_read_seek(&rd, warm);
+
+			while (vstream_read_frame(&rd, list) && rd.frame - 1 < end)
+				vcapture_draw(&capture, list, rd.frame - 1, rd.frame - 1 >= capture_first);
+
+			vstream_read_close(&rd);
 		}
-		fread(vectrex.cart, 1, sizeof(vectrex.cart), f);
-		fclose(f);
 	}
+	else
+	{
+		load_bios();
+		load_cart();
+
+		vectrex.vectors = list;
+		vectrex.render = capture_publish;
+		vecx_reset(&vectrex);
+
+		if (state_filename)
+			vecx_load(&vectrex, state_filename);
+
+		while (capture_frame < end)
+			vecx_emu(&vectrex, FCYCLES_INIT);
+	}
+
+	printf("%u frames written\n", vcapture_close(&capture));
+	free(list);
 }
 
-static void resize(void)
+/* load the overlay with its alpha and OVERLAY_ALPHA multiplied into the
+ * color, it is composed with resize(). renderers without custom blend
+ * modes get it with straight alpha instead.
+ */
+static void load_overlay()
 {
-	int sclx, scly;
-	int screenx, screeny;
-	int width, height;
+	SDL_Surface *image, *argb;
 
-	SDL_GetWindowSize(window, &screenx, &screeny);
+	if (!overlay_filename)
+		return;
 
-	sclx = DAC_MAX_X / screenx;
-	scly = DAC_MAX_Y / screeny;
+	image = IMG_Load(overlay_filename);
+	if (!image)
+	{
+		fprintf(stderr, "IMG_Load: %s\n", IMG_GetError());
+		return;
+	}
 
-	scl_factor = sclx > scly ? sclx : scly;
-	width = DAC_MAX_X / scl_factor;
-	height = DAC_MAX_Y / scl_factor;
+	argb = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_FreeSurface(image);
+	if (!argb)
+	{
+		fprintf(stderr, "Failed to convert overlay: %s\n", SDL_GetError());
+		return;
+	}
 
-	SDL_RenderSetLogicalSize(renderer, width, height);
+	for (int y = 0; y < argb->h; y++)
+	{
+		uint32_t *p = (uint32_t *)((uint8_t *)argb->pixels + (size_t)y * argb->pitch);
 
-	SDL_DestroyTexture(buffer);
-	SDL_DestroyTexture(buffer2);
+		for (int x = 0; x < argb->w; x++)
+			p[x] = ((p[x] >> 24) * OVERLAY_ALPHA / 255) << 24 | (p[x] & 0xffffff);
+	}
 
-	buffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
-	buffer2 = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width / 2, height / 2);
+	overlay = SDL_CreateTextureFromSurface(renderer, argb);
 
-	SDL_SetTextureBlendMode(buffer2, SDL_BLENDMODE_BLEND);
-	SDL_SetTextureAlphaMod(buffer2, 128);
-}
+	/* the straight texture doubles as the probe for the blend mode */
+	overlay_straight = overlay && SDL_SetTextureBlendMode(overlay, premultiplied_blend()) < 0;
 
-static int readevents(void)
-{
-	SDL_Event e;
-	while (SDL_PollEvent(&e))
+	if (overlay && !overlay_straight)
 	{
-		switch (e.type)
+		for (int y = 0; y < argb->h; y++)
 		{
-		case SDL_QUIT:
-			return 1;
-			break;
-		case SDL_WINDOWEVENT:
-			if (e.window.event == SDL_WINDOWEVENT_RESIZED)
-				resize();
-			break;
-		case SDL_DROPFILE:
-			cart_filename = e.drop.file;
-			load_cart();
-			vecx_reset(&vectrex);
-			break;
-		case SDL_KEYDOWN:
-			switch (e.key.keysym.sym)
-			{
-			case SDLK_ESCAPE: return 1;
-			case SDLK_a: vecx_input(&vectrex, VECTREX_PAD1_BUTTON1, 1); break;
-			case SDLK_s: vecx_input(&vectrex, VECTREX_PAD1_BUTTON2, 1); break;
-			case SDLK_d: vecx_input(&vectrex, VECTREX_PAD1_BUTTON3, 1); break;
-			case SDLK_f: vecx_input(&vectrex, VECTREX_PAD1_BUTTON4, 1); break;
-			case SDLK_LEFT: vecx_input(&vectrex, VECTREX_PAD1_X, 0x00); break;
-			case SDLK_RIGHT: vecx_input(&vectrex, VECTREX_PAD1_X, 0xff); break;
-			case SDLK_UP: vecx_input(&vectrex, VECTREX_PAD1_Y, 0xff); break;
-			case SDLK_DOWN: vecx_input(&vectrex, VECTREX_PAD1_Y, 0x00); break;
-			}
-			break;
-		case SDL_KEYUP:
-			switch (e.key.keysym.sym)
+			uint32_t *p = (uint32_t *)((uint8_t *)argb->pixels + (size_t)y * argb->pitch);
+
+			for (int x = 0; x < argb->w; x++)
 			{
-			case SDLK_F1: vecx_load(&vectrex, "q.save"); break;
-			case SDLK_F2: vecx_save(&vectrex, "q.save"); break;
-			case SDLK_r: load_cart(); vecx_reset(&vectrex); break;
-
-			case SDLK_a: vecx_input(&vectrex, VECTREX_PAD1_BUTTON1, 0); break;
-			case SDLK_s: vecx_input(&vectrex, VECTREX_PAD1_BUTTON2, 0); break;
-			case SDLK_d: vecx_input(&vectrex, VECTREX_PAD1_BUTTON3, 0); break;
-			case SDLK_f: vecx_input(&vectrex, VECTREX_PAD1_BUTTON4, 0); break;
-			case SDLK_LEFT: vecx_input(&vectrex, VECTREX_PAD1_X, 0x80); break;
-			case SDLK_RIGHT: vecx_input(&vectrex, VECTREX_PAD1_X, 0x80); break;
-			case SDLK_UP: vecx_input(&vectrex, VECTREX_PAD1_Y, 0x80); break;
-			case SDLK_DOWN: vecx_input(&vectrex, VECTREX_PAD1_Y, 0x80); break;
+				uint32_t a = p[x] >> 24;
+				uint32_t r = (p[x] >> 16 & 0xff) * a / 255;
+				uint32_t g = (p[x] >> 8 & 0xff) * a / 255;
+				uint32_t b = (p[x] & 0xff) * a / 255;
+
+				p[x] = a << 24 | r << 16 | g << 8 | b;
 			}
-			break;
 		}
-	}
-	return 0;
-}
-
-static void emuloop(void)
-{
-	Uint32 next_time = SDL_GetTicks() + EMU_TIMER;
-	vecx_reset(&vectrex);
-	for (;;)
-	{
-		vecx_emu(&vectrex, (VECTREX_MHZ / 1000) * EMU_TIMER);
-		if (readevents()) break;
 
-		{
-			Uint32 now = SDL_GetTicks();
-			if (now < next_time)
-				SDL_Delay(next_time - now);
-			else
-				next_time = now;
-			next_time += EMU_TIMER;
-		}
+		SDL_DestroyTexture(overlay);
+		overlay = SDL_CreateTextureFromSurface(renderer, argb);
 	}
-}
 
-static void load_overlay()
-{
-	if (overlay_filename)
+	SDL_FreeSurface(argb);
+
+	if (!overlay)
 	{
-		SDL_Texture *image = IMG_LoadTexture(renderer, overlay_filename);
-		if (image)
-		{
-			overlay = image;
-			SDL_SetTextureBlendMode(image, SDL_BLENDMODE_BLEND);
-			SDL_SetTextureAlphaMod(image, 128);
-		}
-		else
-		{
-			fprintf(stderr, "IMG_Load: %s\n", IMG_GetError());
-		}
+		fprintf(stderr, "Failed to create overlay: %s\n", SDL_GetError());
+		return;
 	}
+
+	if (overlay_straight)
+		fprintf(stderr, "No premultiplied blending, overlay edges may fringe: %s\n", SDL_GetError());
+
+	/* copied as is into overlay_buffer */
+	SDL_SetTextureBlendMode(overlay, SDL_BLENDMODE_NONE);
 }
 
 static int init(void)
@@ -257,7 +1455,8 @@ static int init(void)
 		return 0;
 	}
 
-	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE |
+		(vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
 	if (!renderer)
 	{
 		fprintf(stderr, "Failed to create renderer: %s\n", SDL_GetError());
@@ -267,6 +1466,12 @@ static int init(void)
 	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
 
+	/* allocated by resize() */
+	vtarget_init(&buffer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET);
+	vtarget_init(&buffer2, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET);
+	vtarget_init(&overlay_buffer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET);
+	vtarget_init(&soft_buffer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING);
+
 	if (fullscreen)
 		SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
 
@@ -275,6 +1480,11 @@ static int init(void)
 
 static void quit(void)
 {
+	vtarget_done(&buffer);
+	vtarget_done(&buffer2);
+	vtarget_done(&overlay_buffer);
+	vtarget_done(&soft_buffer);
+
 	if (renderer)
 		SDL_DestroyRenderer(renderer);
 	if (window)
@@ -296,6 +1506,38 @@ void parse_args(int argc, char* argv[])
 			puts("  --bios <file>     Load bios file");
 			puts("  --overlay <file>  Load overlay file");
 			puts("  --fullscreen      Launch in fullscreen mode");
+			puts("  --rotate <deg>    Turn the picture clockwise: 0, 90, 180, 270");
+			puts("  --renderer <name> Vector renderer: lines, strips, batched, geometry, software");
+			puts("  --raster-threads <n> Threads for the software renderer, 0 one per core");
+			puts("  --phosphor <ms>   Phosphor time constant of the software renderer and trail (48)");
+			puts("  --trail <n>       Draw the last n frames faded by age instead of fading the picture");
+			puts("  --glow-radius <n> Glow reach of the software renderer in pixels (8)");
+			puts("  --glow-strength <f> Glow brightness of the software renderer, 0 off (0.5)");
+			puts("  --upload <mode>   Software frame upload: lock (default), copy");
+			puts("  --threaded        Run emulation and rendering on separate threads");
+			puts("  --vsync           Present at the display refresh, emulating in between");
+			puts("  --slices <n>      Show each frame n times while it is drawn, software only");
+			puts("  --filter          Drop invisible vectors and merge duplicates");
+			puts("  --filter-min <n>  Drop vectors dimmer than n (default 1)");
+			puts("  --filter-stack <n> Keep duplicates, at most n points per spot");
+			puts("  --lod             Collapse runs of vectors shorter than a pixel");
+			puts("  --lod-max <n>     Longest collapsed run in pixels (default 4)");
+			puts("  --stats           Print rendering statistics every second");
+			puts("  --govern <ms>     Lower rendering quality while frames take longer than ms");
+			puts("  --record <file>   Record the vector stream to a .vecstream file");
+			puts("  --play <file>     Benchmark rendering of a .vecstream or raw dump");
+			puts("  --play-fps <n>    Playback rate, 0 for uncapped (default)");
+			puts("  --profile <file>  Write vectors and beam time per 6809 routine on exit");
+			puts("  --hash <file>     Log a hash of every frame's vectors, cpu and ram");
+			puts("  --hash-frames <n> Log n frames without a window as fast as possible");
+			puts("  --hash-compare <a> <b> Report the first frame two hash logs differ at");
+			puts("  --capture <prefix> Render frames to prefix00000.png without a window");
+			puts("  --capture-size <w>x<h> Size of captured frames (default 3840x2160)");
+			puts("  --capture-ss <n>  Supersample captured frames n times per axis, 1-4 (2)");
+			puts("  --capture-first <n> First frame captured (default 0)");
+			puts("  --capture-frames <n> Frames captured (default 1)");
+			puts("  --capture-raw     Capture to raw RGBA files instead of PNG");
+			puts("  --capture-state <file> Start the captured emulation from a save state");
 			exit(0);
 		}
 		else if (strcmp(argv[i], "--bios") == 0 || strcmp(argv[i], "-b") == 0)
@@ -310,6 +1552,177 @@ void parse_args(int argc, char* argv[])
 		{
 			fullscreen = 1;
 		}
+		else if (strcmp(argv[i], "--rotate") == 0)
+		{
+			int deg = atoi(argv[++i]);
+			if (deg < 0 || deg >= 360 || deg % 90 != 0)
+			{
+				printf("Unknown rotation: %d\n", deg);
+				exit(0);
+			}
+			view.config.rotate = deg / 90;
+		}
+		else if (strcmp(argv[i], "--threaded") == 0 || strcmp(argv[i], "-t") == 0)
+		{
+			threaded = 1;
+		}
+		else if (strcmp(argv[i], "--vsync") == 0)
+		{
+			vsync = 1;
+		}
+		else if (strcmp(argv[i], "--slices") == 0)
+		{
+			slices = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--raster-threads") == 0)
+		{
+			raster_threads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--phosphor") == 0)
+		{
+			phosphor_ms = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--upload") == 0)
+		{
+			char *name = argv[++i];
+			if (strcmp(name, "lock") == 0)
+				upload_copy = 0;
+			else if (strcmp(name, "copy") == 0)
+				upload_copy = 1;
+			else
+			{
+				printf("Unknown upload mode: %s\n", name);
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "--glow-radius") == 0)
+		{
+			glow.config.radius = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--glow-strength") == 0)
+		{
+			glow.config.strength = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--filter") == 0)
+		{
+			use_filter = 1;
+		}
+		else if (strcmp(argv[i], "--filter-min") == 0)
+		{
+			use_filter = 1;
+			filter.config.min_color = (uint8_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--filter-stack") == 0)
+		{
+			use_filter = 1;
+			filter.config.merge = 0;
+			filter.config.max_stacked = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--lod") == 0)
+		{
+			use_lod = 1;
+		}
+		else if (strcmp(argv[i], "--trail") == 0)
+		{
+			use_trail = 1;
+			trail.config.frames = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--lod-max") == 0)
+		{
+			use_lod = 1;
+			lod.config.max_len = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--record") == 0)
+		{
+			record_filename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--play") == 0)
+		{
+			play_filename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--play-fps") == 0)
+		{
+			play_fps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--profile") == 0)
+		{
+			profile_filename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--hash") == 0)
+		{
+			hash_filename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--hash-frames") == 0)
+		{
+			hash_frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--capture") == 0)
+		{
+			capture_prefix = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-size") == 0)
+		{
+			char *size = argv[++i];
+			if (sscanf(size, "%dx%d", &capture.config.width, &capture.config.height) != 2)
+			{
+				printf("Unknown capture size: %s\n", size);
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "--capture-ss") == 0)
+		{
+			capture.config.supersample = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--capture-first") == 0)
+		{
+			capture_first = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--capture-frames") == 0)
+		{
+			capture_frames = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--capture-raw") == 0)
+		{
+			capture.config.raw = 1;
+		}
+		else if (strcmp(argv[i], "--capture-state") == 0)
+		{
+			state_filename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--hash-compare") == 0)
+		{
+			compare_filename[0] = argv[++i];
+			compare_filename[1] = argv[++i];
+		}
+		else if (strcmp(argv[i], "--govern") == 0)
+		{
+			govern_ms = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--stats") == 0)
+		{
+			show_stats = 1;
+		}
+		else if (strcmp(argv[i], "--renderer") == 0 || strcmp(argv[i], "-r") == 0)
+		{
+			char *name = argv[++i];
+			if (strcmp(name, "lines") == 0)
+				render_mode = RENDER_LINES;
+			else if (strcmp(name, "strips") == 0)
+				render_mode = RENDER_STRIPS;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+			else if (strcmp(name, "geometry") == 0)
+				render_mode = RENDER_GEOMETRY;
+#endif
+			else if (strcmp(name, "software") == 0)
+				render_mode = RENDER_SOFTWARE;
+			else if (strcmp(name, "batched") == 0)
+				render_mode = RENDER_BATCHED;
+			else
+			{
+				printf("Unknown renderer: %s\n", name);
+				exit(0);
+			}
+		}
 		else if (i == argc - 1)
 		{
 			cart_filename = argv[i];
@@ -324,21 +1737,162 @@ void parse_args(int argc, char* argv[])
 
 int main(int argc, char *argv[])
 {
+	if (!vfilter_init(&filter) || !vlod_init(&lod) || !vglow_init(&glow, 0, 0) || !vview_init(&view) ||
+		!vtrail_init(&trail))
+	{
+		fprintf(stderr, "Failed to allocate filter buffers\n");
+		return 1;
+	}
+
+	vcapture_init(&capture);
+
 	parse_args(argc, argv);
 
+	/* the vsync loop runs the emulator itself */
+	if (vsync || slices > 0)
+		threaded = 0;
+
+	if (slices > 0 && render_mode != RENDER_SOFTWARE)
+	{
+		fprintf(stderr, "--slices needs --renderer software\n");
+		return 1;
+	}
+
+	if (use_trail && render_mode == RENDER_SOFTWARE)
+	{
+		fprintf(stderr, "--trail needs a renderer other than software\n");
+		return 1;
+	}
+
+	if (!vraster_init(&raster, 0, 0))
+		return 1;
+
+	if (phosphor_ms > 0)
+	{
+		raster.config.tau = phosphor_ms / 1000.0f;
+		trail.config.tau = phosphor_ms / 1000.0f;
+	}
+
+	static_settle = settle_frames();
+
+	quality_base.use_filter = use_filter;
+	quality_base.use_lod = use_lod;
+	quality_base.min_color = filter.config.min_color;
+	quality_base.lod_max = lod.config.max_len;
+	quality_base.glow_radius = glow.config.radius;
+	quality_base.glow_strength = glow.config.strength;
+	vgovern_init(&governor, QUALITY_LEVELS - 1, govern_ms);
+
+	if (compare_filename[0])
+		return vhash_compare(compare_filename[0], compare_filename[1]) ? 0 : 1;
+
+	if (hash_filename && !vhash_open(&hash_log, hash_filename))
+		return 1;
+
+	if (hash_frames > 0)
+	{
+		if (!hash_filename)
+		{
+			fprintf(stderr, "--hash-frames needs --hash <file>\n");
+			return 1;
+		}
+
+		hashloop();
+		vhash_close(&hash_log);
+		vfilter_done(&filter);
+		vlod_done(&lod);
+		vtrail_done(&trail);
+		vraster_done(&raster);
+		vglow_done(&glow);
+		vview_done(&view);
+		return 0;
+	}
+
+	if (capture_prefix)
+	{
+		captureloop();
+		vfilter_done(&filter);
+		vlod_done(&lod);
+		vtrail_done(&trail);
+		vraster_done(&raster);
+		vglow_done(&glow);
+		vview_done(&view);
+		return 0;
+	}
+
 	if (!init())
 		quit();
 
-	resize();
-	load_bios();
-	load_cart();
+	if (render_mode == RENDER_SOFTWARE)
+		vraster_threads(&raster, raster_threads);
+
+	if (!vdiff_init(&frame_diff) || !vxchg_init(&frames))
+	{
+		fprintf(stderr, "Failed to allocate frame buffers\n");
+		quit();
+	}
+
+	cmd_lock = SDL_CreateMutex();
+
+	if (record_filename && !vstream_rec_open(&recorder, record_filename))
+	{
+		fprintf(stderr, "Failed to start recording to %s\n", record_filename);
+		quit();
+	}
+
+	if (profile_filename)
+	{
+		if (!vprof_init(&profile))
+		{
+			fprintf(stderr, "Failed to allocate profile buffers\n");
+			quit();
+		}
+
+		vecx_trace(&vectrex, VECX_TRACE_CALLER);
+	}
+
 	load_overlay();
-	e8910_init(&vectrex.PSG);
-    vectrex.render = render;
+	resize();
+
+	if (play_filename)
+	{
+		playloop();
+	}
+	else
+	{
+		load_bios();
+		load_cart();
+		e8910_init(&vectrex.PSG);
+		vectrex.render = publish;
 
-	emuloop();
+		emuloop();
+
+		e8910_done(&vectrex.PSG);
+	}
+
+	vstream_rec_close(&recorder);
+	vhash_close(&hash_log);
+
+	if (govern_ms > 0.0f)
+		vgovern_write(&governor, stdout);
+
+	if (profile_filename)
+	{
+		if (!vprof_write(&profile, profile_filename))
+			perror(profile_filename);
+
+		vprof_done(&profile);
+	}
 
-	e8910_done(&vectrex.PSG);
+	vdiff_done(&frame_diff);
+	vxchg_done(&frames);
+	vfilter_done(&filter);
+	vlod_done(&lod);
+	vtrail_done(&trail);
+	vraster_done(&raster);
+	vglow_done(&glow);
+	vview_done(&view);
+	SDL_DestroyMutex(cmd_lock);
 
 	quit();
 
@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <SDL.h>
 
 #include "ser.h"
 #include "emu\e6522.h"
@@ -96,7 +97,10 @@ static void via_save(VIA6522 *VIA, FILE *file)
 
 static void e8910_load(AY8910 *PSG, FILE *file)
 {
-	fread(PSG->regs, sizeof(PSG->regs[0]), 16, file);
+	/* the sound generator state belongs to the audio thread */
+	SDL_LockAudio();
+
+	fread(PSG->shadow, sizeof(PSG->shadow[0]), 16, file);
 	fread(&PSG->per_a, sizeof(PSG->per_a), 1, file);
 	fread(&PSG->per_b, sizeof(PSG->per_b), 1, file);
 	fread(&PSG->per_c, sizeof(PSG->per_c), 1, file);
@@ -124,11 +128,20 @@ static void e8910_load(AY8910 *PSG, FILE *file)
 	fread(&PSG->attack, sizeof(PSG->attack), 1, file);
 	fread(&PSG->holding, sizeof(PSG->holding), 1, file);
 	fread(&PSG->RNG, sizeof(PSG->RNG), 1, file);
+
+	e8910_flush(PSG);
+	SDL_UnlockAudio();
 }
 
 static void e8910_save(AY8910 *PSG, FILE *file)
 {
-	fwrite(PSG->regs, sizeof(PSG->regs[0]), 16, file);
+	/* the generator state lags shadow by the queued writes, apply them
+	 * so the two are saved consistent
+	 */
+	SDL_LockAudio();
+	e8910_sync(PSG);
+
+	fwrite(PSG->shadow, sizeof(PSG->shadow[0]), 16, file);
 	fwrite(&PSG->per_a, sizeof(PSG->per_a), 1, file);
 	fwrite(&PSG->per_b, sizeof(PSG->per_b), 1, file);
 	fwrite(&PSG->per_c, sizeof(PSG->per_c), 1, file);
@@ -156,6 +169,8 @@ static void e8910_save(AY8910 *PSG, FILE *file)
 	fwrite(&PSG->attack, sizeof(PSG->attack), 1, file);
 	fwrite(&PSG->holding, sizeof(PSG->holding), 1, file);
 	fwrite(&PSG->RNG, sizeof(PSG->RNG), 1, file);
+
+	SDL_UnlockAudio();
 }
 
 void dac_load(DACVec *DAC, FILE *file)
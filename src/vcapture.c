@@ -0,0 +1,288 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "vcapture.h"
+#include "vglow.h"
+#include "vlod.h"
+#include "vraster.h"
+#include "vview.h"
+#include "emu\vlist.h"
+
+/* frame number that tells the writer thread to finish */
+#define VCAPTURE_END UINT32_MAX
+
+void vcapture_init(vcapture *c)
+{
+	memset(c, 0, sizeof(*c));
+
+	c->config.width = 3840;
+	c->config.height = 2160;
+	c->config.supersample = 2;
+	c->config.glow.radius = 8.0f;
+	c->config.glow.strength = 0.5f;
+}
+
+static void free_all(vcapture *c)
+{
+	for (int i = 0; i < VCAPTURE_QUEUE; i++)
+		free(c->queue[i].pixels);
+
+	free(c->row);
+
+	if (c->free)
+		SDL_DestroySemaphore(c->free);
+	if (c->full)
+		SDL_DestroySemaphore(c->full);
+
+	vlod_done(&c->lod);
+	vraster_done(&c->raster);
+	vglow_done(&c->glow);
+	vview_done(&c->view);
+
+	memset(c->queue, 0, sizeof(c->queue));
+	c->row = NULL;
+	c->free = c->full = NULL;
+	c->thread = NULL;
+}
+
+/* pixels as R, G, B, A bytes */
+static int write_raw(vcapture *c, const uint32_t *pixels, const char *name)
+{
+	int w = c->config.width, h = c->config.height;
+	FILE *f = fopen(name, "wb");
+
+	if (!f)
+		return 0;
+
+	for (int y = 0; y < h; y++)
+	{
+		const uint32_t *p = pixels + (size_t)y * w;
+
+		for (int x = 0; x < w; x++)
+		{
+			c->row[4 * x + 0] = (uint8_t)(p[x] >> 16);
+			c->row[4 * x + 1] = (uint8_t)(p[x] >> 8);
+			c->row[4 * x + 2] = (uint8_t)p[x];
+			c->row[4 * x + 3] = (uint8_t)(p[x] >> 24);
+		}
+
+		if (fwrite(c->row, 4, (size_t)w, f) != (size_t)w)
+		{
+			fclose(f);
+			return 0;
+		}
+	}
+
+	return fclose(f) == 0;
+}
+
+static int write_png(vcapture *c, uint32_t *pixels, const char *name)
+{
+	int w = c->config.width, h = c->config.height;
+	SDL_Surface *s = SDL_CreateRGBSurfaceWithFormatFrom(pixels, w, h, 32, w * (int)sizeof(uint32_t),
+		SDL_PIXELFORMAT_ARGB8888);
+	int ok;
+
+	if (!s)
+		return 0;
+
+	ok = IMG_SavePNG(s, name) == 0;
+	SDL_FreeSurface(s);
+	return ok;
+}
+
+static int writer(void *data)
+{
+	vcapture *c = (vcapture *)data;
+	char name[VCAPTURE_NAME_MAX];
+
+	for (;;)
+	{
+		vcapture_frame *frame;
+		int ok;
+
+		SDL_SemWait(c->full);
+		frame = &c->queue[c->tail];
+
+		if (frame->frame == VCAPTURE_END)
+			break;
+
+		vglow_apply(&c->glow, frame->pixels, c->config.width, frame->pixels, c->config.width);
+
+		snprintf(name, sizeof(name), "%s%05u.%s", c->prefix, frame->frame, c->config.raw ? "rgba" : "png");
+		ok = c->config.raw ? write_raw(c, frame->pixels, name) : write_png(c, frame->pixels, name);
+
+		if (ok)
+		{
+			c->written++;
+		}
+		else
+		{
+			fprintf(stderr, "Failed to write %s\n", name);
+			c->failed++;
+		}
+
+		c->tail = (c->tail + 1) % VCAPTURE_QUEUE;
+		SDL_SemPost(c->free);
+	}
+
+	return 0;
+}
+
+int vcapture_open(vcapture *c, const char *prefix)
+{
+	vcapture_config *cfg = &c->config;
+	int ss = cfg->supersample;
+	size_t size = (size_t)cfg->width * cfg->height;
+
+	if (cfg->width <= 0 || cfg->height <= 0 || ss < 1 || ss > VCAPTURE_MAX_SS)
+		return 0;
+
+	c->prefix = prefix;
+	c->head = c->tail = 0;
+	c->written = c->failed = 0;
+
+	if (!vview_init(&c->view) || !vlod_init(&c->lod) ||
+		!vraster_init(&c->raster, cfg->width * ss, cfg->height * ss) ||
+		!vglow_init(&c->glow, cfg->width, cfg->height))
+	{
+		free_all(c);
+		return 0;
+	}
+
+	/* the rasterizer works at the supersampled size. its lines are a pixel
+	 * wide there, brighter by as much as they are thinner in the output
+	 */
+	c->view.config = cfg->view;
+
+	/* the detail that survives is what the output resolves, supersampling
+	 * only smooths the edges
+	 */
+	vview_resize(&c->view, cfg->width, cfg->height);
+	c->lod.config.quant = c->view.quant;
+	if (cfg->lod_max > 0)
+		c->lod.config.max_len = cfg->lod_max;
+
+	vview_resize(&c->view, cfg->width * ss, cfg->height * ss);
+	c->raster.config.xform = c->view.xform;
+	c->raster.config.gain *= (float)ss;
+	if (cfg->tau > 0.0f)
+		c->raster.config.tau = cfg->tau;
+	c->glow.config = cfg->glow;
+
+	for (int i = 0; i < VCAPTURE_QUEUE; i++)
+	{
+		c->queue[i].pixels = malloc(size * sizeof(uint32_t));
+		if (!c->queue[i].pixels)
+		{
+			free_all(c);
+			return 0;
+		}
+	}
+
+	c->row = malloc((size_t)cfg->width * 4);
+	c->free = SDL_CreateSemaphore(VCAPTURE_QUEUE);
+	c->full = SDL_CreateSemaphore(0);
+
+	if (!c->row || !c->free || !c->full)
+	{
+		free_all(c);
+		return 0;
+	}
+
+	vraster_threads(&c->raster, cfg->threads);
+
+	c->thread = SDL_CreateThread(writer, "vcapture", c);
+	if (!c->thread)
+	{
+		fprintf(stderr, "Failed to create capture thread: %s\n", SDL_GetError());
+		free_all(c);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* average ss * ss blocks of src into out. the bytes of a pixel are summed
+ * two at a time in 16 bit halves of a word, which holds up to 16 samples.
+ */
+static void downsample(const uint32_t *src, int src_w, uint32_t *out, int w, int h, int ss)
+{
+	uint32_t n = (uint32_t)(ss * ss);
+	uint32_t recip = (65536 + n - 1) / n; /* rounded up, exact for sums below 16 * 256 */
+
+	for (int y = 0; y < h; y++)
+	{
+		const uint32_t *rows = src + (size_t)y * ss * src_w;
+		uint32_t *o = out + (size_t)y * w;
+
+		for (int x = 0; x < w; x++)
+		{
+			const uint32_t *p = rows + x * ss;
+			uint32_t rb = 0, ag = 0;
+
+			for (int j = 0; j < ss; j++, p += src_w)
+			{
+				for (int i = 0; i < ss; i++)
+				{
+					rb += p[i] & 0x00ff00ffu;
+					ag += p[i] >> 8 & 0x00ff00ffu;
+				}
+			}
+
+			o[x] =
+				((((ag >> 16) + n / 2) * recip >> 16) << 24) |
+				((((rb >> 16) + n / 2) * recip >> 16) << 16) |
+				((((ag & 0xffff) + n / 2) * recip >> 16) << 8) |
+				(((rb & 0xffff) + n / 2) * recip >> 16);
+		}
+	}
+}
+
+void vcapture_draw(vcapture *c, const vlist *list, uint32_t frame, int write)
+{
+	vcapture_frame *f;
+
+	if (!c->thread)
+		return;
+
+	if (c->config.lod)
+		list = vlod_run(&c->lod, list);
+
+	vraster_frame(&c->raster, list, NULL, 0);
+
+	if (!write)
+		return;
+
+	/* waits while the writer is a whole queue behind */
+	SDL_SemWait(c->free);
+
+	f = &c->queue[c->head];
+	f->frame = frame;
+	downsample(c->raster.pixels, c->raster.width, f->pixels, c->config.width, c->config.height,
+		c->config.supersample);
+
+	c->head = (c->head + 1) % VCAPTURE_QUEUE;
+	SDL_SemPost(c->full);
+}
+
+uint32_t vcapture_close(vcapture *c)
+{
+	uint32_t written;
+
+	if (!c->thread)
+		return 0;
+
+	SDL_SemWait(c->free);
+	c->queue[c->head].frame = VCAPTURE_END;
+	SDL_SemPost(c->full);
+	SDL_WaitThread(c->thread, NULL);
+
+	written = c->written;
+	free_all(c);
+	return written;
+}
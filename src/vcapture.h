@@ -0,0 +1,93 @@
+#ifndef __VCAPTURE_H
+#define __VCAPTURE_H
+
+#include <stdint.h>
+#include <SDL.h>
+
+#include "vglow.h"
+#include "vlod.h"
+#include "vraster.h"
+#include "vview.h"
+#include "emu\vlist.h"
+
+enum
+{
+	VCAPTURE_MAX_SS = 4, /* box filter sums stay below 16 bits per channel */
+
+	/* frames waiting for the writer thread */
+	VCAPTURE_QUEUE = 2,
+
+	VCAPTURE_NAME_MAX = 1024
+};
+
+typedef struct
+{
+	int width, height; /* output size */
+	int supersample;   /* rasterized at this many times the size per axis */
+	int raw;           /* write .rgba files instead of png */
+	int threads;       /* raster threads, 0 one per core */
+	float tau;         /* phosphor time constant, 0 keeps the default */
+	int lod;           /* collapse runs shorter than an output pixel */
+	uint32_t lod_max;  /* longest collapsed run in output pixels, 0 keeps the default */
+	vview_config view;
+	vglow_config glow; /* radius in output pixels */
+} vcapture_config;
+
+/* a frame waiting to be written */
+typedef struct
+{
+	uint32_t frame;
+	uint32_t *pixels; /* output size ARGB8888, glow not applied yet */
+} vcapture_frame;
+
+/* renders frames offline at any size, without a window or the gpu.
+ *
+ * the software rasterizer draws the frame at supersample times the output
+ * size on all cores. the frame is box filtered down to the output size,
+ * then a writer thread adds the glow and writes the file while the next
+ * frame is drawn, so the single threaded encode only costs time when it is
+ * slower than drawing.
+ *
+ * files are named after the prefix and the frame number, prefix00042.png.
+ * raw files hold the pixels as R, G, B, A bytes row after row.
+ */
+typedef struct
+{
+	vcapture_config config;
+
+	vview view;
+	vlod lod;          /* its own, tuned to the output pixels and not the window's */
+	vraster raster;
+	vglow glow;        /* writer thread only once open */
+	const char *prefix;
+
+	vcapture_frame queue[VCAPTURE_QUEUE];
+	int head;          /* next slot to fill, producer only */
+	int tail;          /* next slot to write, writer only */
+	SDL_sem *free;
+	SDL_sem *full;
+	SDL_Thread *thread;
+	uint8_t *row;      /* a row of a raw file, writer only */
+
+	uint32_t written;  /* files written, writer only */
+	uint32_t failed;   /* files that could not be written, writer only */
+} vcapture;
+
+/* set the defaults, 3840x2160 supersampled twice. change config before
+ * vcapture_open.
+ */
+void vcapture_init(vcapture *c);
+
+int vcapture_open(vcapture *c, const char *prefix);
+
+/* draw the next frame. with write 0 it only builds up the phosphor of the
+ * frames that follow.
+ */
+void vcapture_draw(vcapture *c, const vlist *list, uint32_t frame, int write);
+
+/* wait for the files still queued to be written and free everything.
+ * returns the number of files written.
+ */
+uint32_t vcapture_close(vcapture *c);
+
+#endif
@@ -0,0 +1,198 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vdiff.h"
+#include "emu\vlist.h"
+
+static uint64_t mix64(uint64_t x)
+{
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/* lsd radix sort on the key, a byte per pass. the result ends up in src. */
+static void sort_entries(vdiff_entry *src, vdiff_entry *tmp, size_t cnt)
+{
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t count[256] = { 0 };
+		size_t pos = 0;
+
+		for (size_t i = 0; i < cnt; i++)
+			count[(src[i].key >> shift) & 0xff]++;
+
+		for (int b = 0; b < 256; b++)
+		{
+			size_t c = count[b];
+			count[b] = pos;
+			pos += c;
+		}
+
+		for (size_t i = 0; i < cnt; i++)
+			tmp[count[(src[i].key >> shift) & 0xff]++] = src[i];
+
+		/* eight passes, so the data is back in src at the end */
+		vdiff_entry *t = src;
+		src = tmp;
+		tmp = t;
+	}
+}
+
+int vdiff_init(vdiff *diff)
+{
+	memset(diff, 0, sizeof(*diff));
+
+	diff->prev = malloc(VLIST_MAX_CNT * sizeof(vdiff_entry));
+	diff->curr = malloc(VLIST_MAX_CNT * sizeof(vdiff_entry));
+	diff->tmp = malloc(VLIST_MAX_CNT * sizeof(vdiff_entry));
+	diff->removed = malloc(VLIST_MAX_CNT * sizeof(vdiff_entry));
+	diff->added = malloc(VLIST_MAX_CNT * sizeof(vdiff_entry));
+
+	if (!diff->prev || !diff->curr || !diff->tmp || !diff->removed || !diff->added)
+	{
+		vdiff_done(diff);
+		return 0;
+	}
+
+	vdiff_reset(diff, 1);
+	return 1;
+}
+
+void vdiff_done(vdiff *diff)
+{
+	free(diff->prev);
+	free(diff->curr);
+	free(diff->tmp);
+	free(diff->removed);
+	free(diff->added);
+	memset(diff, 0, sizeof(*diff));
+}
+
+void vdiff_reset(vdiff *diff, int32_t quant)
+{
+	diff->quant = quant > VDIFF_MIN_QUANT ? quant : VDIFF_MIN_QUANT;
+	diff->valid = 0;
+	diff->hash = 0;
+	diff->list_cnt = 0;
+	diff->cnt = 0;
+	diff->unchanged = 0;
+	diff->added_cnt = 0;
+	diff->removed_cnt = 0;
+}
+
+int vdiff_update(vdiff *diff, const vlist *list)
+{
+	vdiff_entry *curr = diff->curr;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	int32_t q = diff->quant;
+	size_t cnt = list->cnt;
+
+	for (size_t i = 0; i < cnt; i++)
+	{
+		/* 14 bits a coordinate and 8 for the color fill the word without
+		 * overlapping, mix64 is a bijection so keys only match for equal
+		 * vectors
+		 */
+		uint64_t packed = (uint64_t)(list->x0[i] / q) |
+			(uint64_t)(list->y0[i] / q) << 14 |
+			(uint64_t)(list->x1[i] / q) << 28 |
+			(uint64_t)(list->y1[i] / q) << 42 |
+			(uint64_t)list->color[i] << 56;
+		uint64_t key = mix64(packed);
+
+		curr[i].key = key;
+		curr[i].x0 = list->x0[i];
+		curr[i].y0 = list->y0[i];
+		curr[i].x1 = list->x1[i];
+		curr[i].y1 = list->y1[i];
+		curr[i].color = list->color[i];
+
+		hash = (hash ^ key) * 0x100000001b3ULL;
+	}
+
+	if (diff->valid && cnt == diff->list_cnt && hash == diff->hash)
+	{
+		/* same vectors in the same order. the sorted copy of the last
+		 * frame stays valid.
+		 */
+		diff->unchanged++;
+		diff->added_cnt = 0;
+		diff->removed_cnt = 0;
+		return 1;
+	}
+
+	diff->list_cnt = cnt;
+	diff->hash = hash;
+
+	sort_entries(curr, diff->tmp, cnt);
+
+	/* drop repeats */
+	if (cnt > 0)
+	{
+		size_t u = 1;
+
+		for (size_t i = 1; i < cnt; i++)
+		{
+			if (curr[i].key != curr[u - 1].key)
+				curr[u++] = curr[i];
+		}
+
+		cnt = u;
+	}
+
+	/* merge the two sorted frames, entries only in the current one were
+	 * added and entries only in the previous one were removed.
+	 */
+	{
+		vdiff_entry *prev = diff->prev;
+		size_t p = 0, c = 0;
+		size_t added_cnt = 0, removed_cnt = 0;
+
+		while (p < diff->cnt || c < cnt)
+		{
+			if (c == cnt || (p < diff->cnt && prev[p].key < curr[c].key))
+			{
+				diff->removed[removed_cnt++] = prev[p++];
+			}
+			else if (p == diff->cnt || curr[c].key < prev[p].key)
+			{
+				diff->added[added_cnt++] = curr[c++];
+			}
+			else
+			{
+				p++;
+				c++;
+			}
+		}
+
+		diff->added_cnt = added_cnt;
+		diff->removed_cnt = removed_cnt;
+	}
+
+	diff->curr = diff->prev;
+	diff->prev = curr;
+	diff->cnt = cnt;
+
+	if (!diff->valid)
+	{
+		diff->valid = 1;
+		diff->unchanged = 0;
+		return 0;
+	}
+
+	if (diff->added_cnt == 0 && diff->removed_cnt == 0)
+	{
+		/* same vectors in a different order or repeated differently */
+		diff->unchanged++;
+		return 1;
+	}
+
+	diff->unchanged = 0;
+	return 0;
+}
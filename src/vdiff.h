@@ -0,0 +1,65 @@
+#ifndef __VDIFF_H
+#define __VDIFF_H
+
+#include "emu\vlist.h"
+
+enum
+{
+	VDIFF_MIN_QUANT = 4 /* keeps a quantized coordinate within 14 bits */
+};
+
+/* a vector reduced to display resolution */
+typedef struct
+{
+	uint64_t key; /* hash of the quantized coordinates and color */
+	uint16_t x0, y0;
+	uint16_t x1, y1;
+	uint8_t color;
+} vdiff_entry;
+
+typedef struct
+{
+	int32_t quant;      /* dac units per display pixel */
+
+	int valid;          /* is there a last frame to compare with? */
+	uint64_t hash;      /* hash of the last frame in emission order */
+	size_t list_cnt;    /* number of vectors in the last frame */
+	uint32_t unchanged; /* consecutive frames the list stayed the same */
+
+	/* distinct vectors of the last frame sorted by key */
+	size_t cnt;
+	vdiff_entry *prev;
+
+	/* result of the last vdiff_update, vectors that are only in the current
+	 * frame and vectors that were only in the previous one.
+	 */
+	size_t added_cnt;
+	vdiff_entry *added;
+	size_t removed_cnt;
+	vdiff_entry *removed;
+
+	/* scratch */
+	vdiff_entry *curr;
+	vdiff_entry *tmp;
+} vdiff;
+
+int vdiff_init(vdiff *diff);
+void vdiff_done(vdiff *diff);
+
+/* forget the previous frame, the next update reports everything as added.
+ * call when the quantization changes or the renderer lost its output.
+ * quant is raised to VDIFF_MIN_QUANT.
+ */
+void vdiff_reset(vdiff *diff, int32_t quant);
+
+/* compare a frame with the previous one. returns 1 if both draw the same
+ * vectors at display resolution, in which case added and removed are left
+ * empty.
+ *
+ * frames are compared as sets: a frame lasts longer than a game's refresh
+ * so some vectors show up twice, and which ones depends on where the frame
+ * boundary fell.
+ */
+int vdiff_update(vdiff *diff, const vlist *list);
+
+#endif
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vfilter.h"
+#include "emu\vlist.h"
+
+enum
+{
+	/* power of two, at least twice VLIST_MAX_CNT */
+	VFILTER_SLOTS = 1 << 17,
+
+	/* brightest color a merged vector can reach, VECTREX_COLORS - 1 */
+	VFILTER_MAX_COLOR = 127
+};
+
+int vfilter_init(vfilter *filter)
+{
+	memset(filter, 0, sizeof(*filter));
+
+	filter->config.min_color = 1;
+	filter->config.merge = 1;
+	filter->config.max_stacked = 0;
+
+	filter->out = malloc(sizeof(vlist));
+	filter->slots = calloc(VFILTER_SLOTS, sizeof(vfilter_slot));
+
+	if (!filter->out || !filter->slots)
+	{
+		vfilter_done(filter);
+		return 0;
+	}
+
+	vlist_clear(filter->out);
+	return 1;
+}
+
+void vfilter_done(vfilter *filter)
+{
+	free(filter->out);
+	free(filter->slots);
+	memset(filter, 0, sizeof(*filter));
+}
+
+const vlist *vfilter_run(vfilter *filter, const vlist *in)
+{
+	const vfilter_config *config = &filter->config;
+	vfilter_stats *stats = &filter->stats;
+	vlist *out = filter->out;
+	uint32_t gen = ++filter->gen;
+
+	if (gen == 0)
+	{
+		/* wrapped around, stale slots could look current */
+		memset(filter->slots, 0, VFILTER_SLOTS * sizeof(vfilter_slot));
+		gen = filter->gen = 1;
+	}
+
+	vlist_clear(out);
+	out->start = in->start;
+	out->cycles = in->cycles;
+	memset(stats, 0, sizeof(*stats));
+	stats->in = (uint32_t)in->cnt;
+
+	for (size_t i = 0; i < in->cnt; i++)
+	{
+		uint16_t x0 = in->x0[i], y0 = in->y0[i];
+		uint16_t x1 = in->x1[i], y1 = in->y1[i];
+		uint8_t color = in->color[i];
+		uint16_t t = in->t[i];
+		int point = x0 == x1 && y0 == y1;
+		vfilter_slot *slot;
+		uint32_t h;
+
+		if (color < config->min_color)
+		{
+			stats->dim++;
+			continue;
+		}
+
+		if (!config->merge && (!point || config->max_stacked == 0))
+		{
+			vlist_add(out, x0, y0, x1, y1, color, t);
+			continue;
+		}
+
+		/* find the slot of this vector, linear probing */
+		h = ((uint32_t)x0 | (uint32_t)y0 << 16) * 0x9e3779b1u;
+		h ^= ((uint32_t)x1 | (uint32_t)y1 << 16) * 0x85ebca6bu;
+		h = (h ^ (h >> 15)) & (VFILTER_SLOTS - 1);
+
+		for (;;)
+		{
+			slot = &filter->slots[h];
+
+			if (slot->gen != gen)
+				break;
+
+			if (out->x0[slot->idx] == x0 && out->y0[slot->idx] == y0 &&
+				out->x1[slot->idx] == x1 && out->y1[slot->idx] == y1)
+				break;
+
+			h = (h + 1) & (VFILTER_SLOTS - 1);
+		}
+
+		if (slot->gen == gen)
+		{
+			if (config->merge)
+			{
+				uint32_t sum = (uint32_t)out->color[slot->idx] + color;
+				out->color[slot->idx] = (uint8_t)(sum > VFILTER_MAX_COLOR ? VFILTER_MAX_COLOR : sum);
+				out->vcolor[slot->vert] = out->color[slot->idx]; /* the strips draw the same */
+				out->t[slot->idx] = t; /* the latest copy is the brightest on screen */
+				stats->merged++;
+				continue;
+			}
+
+			if (slot->cnt >= config->max_stacked)
+			{
+				stats->stacked++;
+				continue;
+			}
+
+			slot->cnt++;
+		}
+		else
+		{
+			if (out->cnt >= VLIST_MAX_CNT)
+				continue;
+
+			slot->gen = gen;
+			slot->idx = (uint32_t)out->cnt;
+			slot->cnt = 1;
+		}
+
+		vlist_add(out, x0, y0, x1, y1, color, t);
+
+		/* the end vertex of the vector just added */
+		slot->vert = (uint32_t)out->vert_cnt - 1;
+	}
+
+	stats->out = (uint32_t)out->cnt;
+	return out;
+}
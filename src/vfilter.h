@@ -0,0 +1,53 @@
+#ifndef __VFILTER_H
+#define __VFILTER_H
+
+#include "emu\vlist.h"
+
+typedef struct
+{
+	uint8_t min_color;    /* dimmer vectors are dropped, 1 drops only invisible ones */
+	uint8_t merge;        /* fold identical vectors into one, summing intensity */
+	uint32_t max_stacked; /* points drawn at one coordinate when not merging, 0 = no limit */
+} vfilter_config;
+
+/* what happened to the last frame */
+typedef struct
+{
+	uint32_t in;
+	uint32_t dim;     /* dropped for being below min_color */
+	uint32_t merged;  /* folded into an identical vector */
+	uint32_t stacked; /* points over max_stacked */
+	uint32_t out;
+} vfilter_stats;
+
+typedef struct
+{
+	uint32_t gen;
+	uint32_t idx; /* index into the output list */
+	uint32_t vert; /* strip vertex of its end in the output list */
+	uint32_t cnt; /* vectors seen at this slot this frame */
+} vfilter_slot;
+
+typedef struct
+{
+	vfilter_config config;
+	vfilter_stats stats;
+
+	vlist *out;
+
+	/* open addressed table of the frame's distinct vectors. slots from an
+	 * older generation are empty, so it never needs clearing.
+	 */
+	uint32_t gen;
+	vfilter_slot *slots;
+} vfilter;
+
+int vfilter_init(vfilter *filter);
+void vfilter_done(vfilter *filter);
+
+/* run a frame through the filter. the result stays valid until the next
+ * call.
+ */
+const vlist *vfilter_run(vfilter *filter, const vlist *in);
+
+#endif
@@ -0,0 +1,425 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "vglow.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VGLOW_X86
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_SSE2
+#endif
+
+/* 1 4 6 4 1 binomial kernel, close to a gaussian with a sigma of a pixel */
+#define K0 0.375f
+#define K1 0.25f
+#define K2 0.0625f
+
+int vglow_init(vglow *g, int width, int height)
+{
+	memset(g, 0, sizeof(*g));
+
+	g->config.radius = 8.0f;
+	g->config.strength = 0.5f;
+
+#ifdef VGLOW_X86
+	g->simd = SDL_HasSSE2();
+#endif
+
+	return vglow_resize(g, width, height);
+}
+
+static void free_buffers(vglow *g)
+{
+	for (int i = 0; i < g->level_cnt; i++)
+		free(g->levels[i].data);
+
+	free(g->tmp);
+	free(g->row);
+	free(g->zero);
+
+	memset(g->levels, 0, sizeof(g->levels));
+	g->level_cnt = 0;
+	g->tmp = g->row = g->zero = NULL;
+}
+
+void vglow_done(vglow *g)
+{
+	free_buffers(g);
+}
+
+int vglow_resize(vglow *g, int width, int height)
+{
+	int w = (width + 1) / 2, h = (height + 1) / 2;
+	size_t size;
+
+	free_buffers(g);
+
+	g->width = width > 0 ? width : 0;
+	g->height = height > 0 ? height : 0;
+
+	if (width < 2 || height < 2)
+		return 1;
+
+	for (int i = 0; i < VGLOW_MAX_LEVELS; i++)
+	{
+		vglow_level *l = &g->levels[i];
+
+		l->width = w;
+		l->height = h;
+		l->stride = VGLOW_PAD + ((w + 3) & ~3) + VGLOW_PAD;
+		l->data = calloc((size_t)l->stride * h, sizeof(float));
+
+		if (!l->data)
+		{
+			free_buffers(g);
+			return 0;
+		}
+
+		l->origin = l->data + VGLOW_PAD;
+		g->level_cnt++;
+
+		if (w < 2 || h < 2)
+			break;
+
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	size = (size_t)g->levels[0].stride;
+	g->tmp = calloc(size * g->levels[0].height, sizeof(float));
+	g->row = calloc(size, sizeof(float));
+	g->zero = calloc(size, sizeof(float));
+
+	if (!g->tmp || !g->row || !g->zero)
+	{
+		free_buffers(g);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* level 0 is the frame at half size, in 0..1 */
+static void downsample_pixels(vglow *g, const uint32_t *pixels, int pitch)
+{
+	const vglow_level *dst = &g->levels[0];
+	int w = g->width;
+
+	for (int y = 0; y < dst->height; y++)
+	{
+		const uint32_t *a = pixels + (size_t)2 * y * pitch;
+		const uint32_t *b = 2 * y + 1 < g->height ? a + pitch : a;
+		float *out = dst->origin + y * dst->stride;
+		int x = 0;
+
+#ifdef VGLOW_X86
+		if (g->simd)
+		{
+			__m128i mask = _mm_set1_epi32(0xff);
+			__m128 k = _mm_set1_ps(0.25f / 255.0f);
+
+			for (; 2 * (x + 4) <= w; x += 4)
+			{
+				__m128i lo = _mm_add_epi32(
+					_mm_and_si128(_mm_loadu_si128((const __m128i *)(a + 2 * x)), mask),
+					_mm_and_si128(_mm_loadu_si128((const __m128i *)(b + 2 * x)), mask));
+				__m128i hi = _mm_add_epi32(
+					_mm_and_si128(_mm_loadu_si128((const __m128i *)(a + 2 * x + 4)), mask),
+					_mm_and_si128(_mm_loadu_si128((const __m128i *)(b + 2 * x + 4)), mask));
+				__m128 fl = _mm_cvtepi32_ps(lo), fh = _mm_cvtepi32_ps(hi);
+				__m128 even = _mm_shuffle_ps(fl, fh, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 odd = _mm_shuffle_ps(fl, fh, _MM_SHUFFLE(3, 1, 3, 1));
+
+				_mm_storeu_ps(out + x, _mm_mul_ps(_mm_add_ps(even, odd), k));
+			}
+		}
+#endif
+		for (; x < dst->width; x++)
+		{
+			int x1 = 2 * x + 1 < w ? 2 * x + 1 : 2 * x;
+
+			out[x] = ((a[2 * x] & 0xff) + (a[x1] & 0xff) + (b[2 * x] & 0xff) + (b[x1] & 0xff)) *
+				(0.25f / 255.0f);
+		}
+	}
+}
+
+static void downsample_level(const vglow_level *src, const vglow_level *dst)
+{
+	for (int y = 0; y < dst->height; y++)
+	{
+		const float *a = src->origin + 2 * y * src->stride;
+		const float *b = 2 * y + 1 < src->height ? a + src->stride : a;
+		float *out = dst->origin + y * dst->stride;
+
+		for (int x = 0; x < dst->width; x++)
+		{
+			int x1 = 2 * x + 1 < src->width ? 2 * x + 1 : 2 * x;
+
+			out[x] = (a[2 * x] + a[x1] + b[2 * x] + b[x1]) * 0.25f;
+		}
+	}
+}
+
+static void blur_h_scalar(const float *s, float *d, int x, int n)
+{
+	for (; x < n; x++)
+		d[x] = K2 * (s[x - 2] + s[x + 2]) + K1 * (s[x - 1] + s[x + 1]) + K0 * s[x];
+}
+
+static void blur_v_scalar(const float *const *r, float *d, int x, int n)
+{
+	for (; x < n; x++)
+		d[x] = K2 * (r[0][x] + r[4][x]) + K1 * (r[1][x] + r[3][x]) + K0 * r[2][x];
+}
+
+#ifdef VGLOW_X86
+/* the taps are unaligned loads of the same row, reading into the pads */
+TARGET_SSE2 static int blur_h_sse2(const float *s, float *d, int n)
+{
+	__m128 k0 = _mm_set1_ps(K0), k1 = _mm_set1_ps(K1), k2 = _mm_set1_ps(K2);
+	int x;
+
+	for (x = 0; x + 4 <= n; x += 4)
+	{
+		__m128 v = _mm_mul_ps(k2, _mm_add_ps(_mm_loadu_ps(s + x - 2), _mm_loadu_ps(s + x + 2)));
+
+		v = _mm_add_ps(v, _mm_mul_ps(k1, _mm_add_ps(_mm_loadu_ps(s + x - 1), _mm_loadu_ps(s + x + 1))));
+		v = _mm_add_ps(v, _mm_mul_ps(k0, _mm_loadu_ps(s + x)));
+		_mm_storeu_ps(d + x, v);
+	}
+
+	return x;
+}
+
+TARGET_SSE2 static int blur_v_sse2(const float *const *r, float *d, int n)
+{
+	__m128 k0 = _mm_set1_ps(K0), k1 = _mm_set1_ps(K1), k2 = _mm_set1_ps(K2);
+	int x;
+
+	for (x = 0; x + 4 <= n; x += 4)
+	{
+		__m128 v = _mm_mul_ps(k2, _mm_add_ps(_mm_loadu_ps(r[0] + x), _mm_loadu_ps(r[4] + x)));
+
+		v = _mm_add_ps(v, _mm_mul_ps(k1, _mm_add_ps(_mm_loadu_ps(r[1] + x), _mm_loadu_ps(r[3] + x))));
+		v = _mm_add_ps(v, _mm_mul_ps(k0, _mm_loadu_ps(r[2] + x)));
+		_mm_storeu_ps(d + x, v);
+	}
+
+	return x;
+}
+#endif
+
+/* blur a level in place, going through tmp. nothing past the width is
+ * written so the pads stay zero.
+ */
+static void blur_level(vglow *g, const vglow_level *l)
+{
+	for (int y = 0; y < l->height; y++)
+	{
+		const float *s = l->origin + y * l->stride;
+		float *d = g->tmp + VGLOW_PAD + y * l->stride;
+		int x = 0;
+
+#ifdef VGLOW_X86
+		if (g->simd)
+			x = blur_h_sse2(s, d, l->width);
+#endif
+		blur_h_scalar(s, d, x, l->width);
+	}
+
+	for (int y = 0; y < l->height; y++)
+	{
+		const float *r[5];
+		float *d = l->origin + y * l->stride;
+		int x = 0;
+
+		for (int i = 0; i < 5; i++)
+		{
+			int ry = y + i - 2;
+
+			r[i] = ry >= 0 && ry < l->height ? g->tmp + VGLOW_PAD + ry * l->stride : g->zero;
+		}
+
+#ifdef VGLOW_X86
+		if (g->simd)
+			x = blur_v_sse2(r, d, l->width);
+#endif
+		blur_v_scalar(r, d, x, l->width);
+	}
+}
+
+/* the row of src halfway between the two rows nearest to row y of the
+ * level twice its size, weighted 3:1 like a bilinear filter. the ends are
+ * repeated into the pads for the horizontal filter.
+ */
+static float *upsample_row(vglow *g, const vglow_level *src, int y)
+{
+	int sy = y >> 1;
+	int ny = y & 1 ? sy + 1 : sy - 1;
+	const float *a, *b;
+	float *row = g->row + VGLOW_PAD;
+	int x = 0;
+
+	if (ny < 0)
+		ny = 0;
+	if (ny >= src->height)
+		ny = src->height - 1;
+
+	a = src->origin + sy * src->stride;
+	b = src->origin + ny * src->stride;
+
+#ifdef VGLOW_X86
+	if (g->simd)
+	{
+		__m128 k3 = _mm_set1_ps(0.75f), k1 = _mm_set1_ps(0.25f);
+
+		for (; x + 4 <= src->width; x += 4)
+		{
+			_mm_storeu_ps(row + x, _mm_add_ps(_mm_mul_ps(k3, _mm_loadu_ps(a + x)),
+				_mm_mul_ps(k1, _mm_loadu_ps(b + x))));
+		}
+	}
+#endif
+	for (; x < src->width; x++)
+		row[x] = 0.75f * a[x] + 0.25f * b[x];
+
+	row[-1] = row[0];
+	row[src->width] = row[src->width - 1];
+	return row;
+}
+
+static void upsample_add(vglow *g, const vglow_level *src, const vglow_level *dst)
+{
+	for (int y = 0; y < dst->height; y++)
+	{
+		const float *row = upsample_row(g, src, y);
+		float *d = dst->origin + y * dst->stride;
+
+		for (int x = 0; x < dst->width; x++)
+		{
+			int i = x >> 1;
+
+			d[x] += 0.75f * row[i] + 0.25f * row[x & 1 ? i + 1 : i - 1];
+		}
+	}
+}
+
+static uint32_t add_gray(uint32_t p, float v)
+{
+	float s = (float)(p & 0xff) + v;
+
+	/* rounded to even like _mm_cvtps_epi32, so both paths agree on ties */
+	uint32_t c = (uint32_t)lrintf(s < 255.0f ? s : 255.0f);
+
+	return 0xff000000u | c << 16 | c << 8 | c;
+}
+
+#ifdef VGLOW_X86
+/* the even and odd pixels of eight come out of four row entries, then get
+ * interleaved back into order
+ */
+TARGET_SSE2 static int composite_sse2(const float *row, const uint32_t *src, uint32_t *p, int w, float k)
+{
+	__m128 k3 = _mm_set1_ps(0.75f), k1 = _mm_set1_ps(0.25f);
+	__m128 kk = _mm_set1_ps(k), max = _mm_set1_ps(255.0f);
+	__m128i mask = _mm_set1_epi32(0xff), alpha = _mm_set1_epi32((int)0xff000000u);
+	int i;
+
+	for (i = 0; 2 * i + 8 <= w; i += 4)
+	{
+		__m128 c = _mm_mul_ps(k3, _mm_loadu_ps(row + i));
+		__m128 e = _mm_mul_ps(kk, _mm_add_ps(c, _mm_mul_ps(k1, _mm_loadu_ps(row + i - 1))));
+		__m128 o = _mm_mul_ps(kk, _mm_add_ps(c, _mm_mul_ps(k1, _mm_loadu_ps(row + i + 1))));
+		__m128 v[2];
+
+		v[0] = _mm_unpacklo_ps(e, o);
+		v[1] = _mm_unpackhi_ps(e, o);
+
+		for (int h = 0; h < 2; h++)
+		{
+			const __m128i *a = (const __m128i *)(src + 2 * i + 4 * h);
+			__m128i *q = (__m128i *)(p + 2 * i + 4 * h);
+			__m128 s = _mm_add_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_loadu_si128(a), mask)), v[h]);
+			__m128i g = _mm_cvtps_epi32(_mm_min_ps(s, max));
+
+			g = _mm_or_si128(_mm_or_si128(g, _mm_slli_epi32(g, 8)), _mm_slli_epi32(g, 16));
+			_mm_storeu_si128(q, _mm_or_si128(g, alpha));
+		}
+	}
+
+	return 2 * i;
+}
+#endif
+
+/* add level 0 brought up to full size, scaled by k, to the pixels of src
+ * and write them to out. out is only written.
+ */
+static void composite(vglow *g, const uint32_t *src, int src_pitch, uint32_t *out, int pitch, float k)
+{
+	const vglow_level *l0 = &g->levels[0];
+	int w = g->width;
+
+	for (int y = 0; y < g->height; y++)
+	{
+		const float *row = upsample_row(g, l0, y);
+		const uint32_t *a = src + (size_t)y * src_pitch;
+		uint32_t *p = out + (size_t)y * pitch;
+		int x = 0;
+
+#ifdef VGLOW_X86
+		if (g->simd)
+			x = composite_sse2(row, a, p, w, k);
+#endif
+		for (; x < w; x++)
+		{
+			int i = x >> 1;
+
+			p[x] = add_gray(a[x], k * (0.75f * row[i] + 0.25f * row[x & 1 ? i + 1 : i - 1]));
+		}
+	}
+}
+
+int vglow_active(const vglow *g)
+{
+	return g->level_cnt > 0 && g->config.strength > 0.0f;
+}
+
+void vglow_apply(vglow *g, const uint32_t *src, int src_pitch, uint32_t *out, int pitch)
+{
+	int cnt = 1;
+
+	if (!vglow_active(g))
+	{
+		if (out != src)
+		{
+			for (int y = 0; y < g->height; y++)
+				memcpy(out + (size_t)y * pitch, src + (size_t)y * src_pitch, (size_t)g->width * sizeof(uint32_t));
+		}
+		return;
+	}
+
+	/* level i blurs with a sigma of 2^(i + 1) pixels */
+	while (cnt < g->level_cnt && (float)(4 << cnt) <= g->config.radius)
+		cnt++;
+
+	downsample_pixels(g, src, src_pitch);
+	for (int i = 1; i < cnt; i++)
+		downsample_level(&g->levels[i - 1], &g->levels[i]);
+
+	for (int i = 0; i < cnt; i++)
+		blur_level(g, &g->levels[i]);
+
+	for (int i = cnt - 1; i > 0; i--)
+		upsample_add(g, &g->levels[i], &g->levels[i - 1]);
+
+	composite(g, src, src_pitch, out, pitch, g->config.strength * 255.0f / cnt);
+}
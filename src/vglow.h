@@ -0,0 +1,68 @@
+#ifndef __VGLOW_H
+#define __VGLOW_H
+
+#include <stdint.h>
+
+enum
+{
+	/* zero floats left and right of every row so the blur taps can run
+	 * past the edges, a whole simd vector to keep rows aligned
+	 */
+	VGLOW_PAD = 4,
+
+	/* each level halves the size, the last one is 1/64 of the frame */
+	VGLOW_MAX_LEVELS = 6
+};
+
+typedef struct
+{
+	float radius;   /* reach of the glow in pixels */
+	float strength; /* glow added on top of a full intensity pixel, 0 is off */
+} vglow_config;
+
+/* a level of the pyramid */
+typedef struct
+{
+	int width, height;
+	int stride;    /* floats per row, pads included */
+	float *data;   /* allocation */
+	float *origin; /* pixel 0, 0 */
+} vglow_level;
+
+/* glow around bright pixels of the software framebuffer. the frame is
+ * halved into a pyramid, every level is blurred with the same small
+ * separable kernel and the levels are added back up on the way to full
+ * size. each level doubles the reach of the one before, so the radius only
+ * picks how many of the ever smaller levels take part and the cost stays
+ * at about that of blurring the half size level, whatever the radius.
+ */
+typedef struct
+{
+	vglow_config config;
+
+	int width, height;  /* framebuffer size */
+	int level_cnt;      /* levels allocated */
+	vglow_level levels[VGLOW_MAX_LEVELS];
+	float *tmp;         /* horizontal pass output, as big as level 0 */
+	float *row;         /* a padded row of level 0 */
+	float *zero;        /* stands in for the rows past the edges */
+
+	int simd;           /* use the sse2 kernels */
+} vglow;
+
+/* a size of 0 leaves allocating to the first vglow_resize */
+int vglow_init(vglow *g, int width, int height);
+void vglow_done(vglow *g);
+int vglow_resize(vglow *g, int width, int height);
+
+/* is there any glow to add? */
+int vglow_active(const vglow *g);
+
+/* add the glow to width * height gray ARGB8888 pixels of src, rows
+ * src_pitch pixels apart, and write them to out, rows pitch pixels apart.
+ * out may be src. otherwise it is only written, never read, so it can point
+ * into a locked texture. without glow src is copied.
+ */
+void vglow_apply(vglow *g, const uint32_t *src, int src_pitch, uint32_t *out, int pitch);
+
+#endif
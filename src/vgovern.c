@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vgovern.h"
+
+void vgovern_init(vgovern *g, int max_level, float budget)
+{
+	memset(g, 0, sizeof(*g));
+
+	g->config.budget = budget;
+	g->config.headroom = 0.5f;
+	g->config.down_frames = 3;
+	g->config.up_frames = 60;
+
+	g->max_level = max_level;
+	g->up_wait = g->config.up_frames;
+}
+
+static void change(vgovern *g, int level)
+{
+	vgovern_change *c = &g->history[g->change_cnt % VGOVERN_HISTORY];
+
+	c->frame = g->frame;
+	c->from = (uint8_t)g->level;
+	c->to = (uint8_t)level;
+	c->ms = g->ms;
+
+	g->change_cnt++;
+	g->level = level;
+	g->over = 0;
+	g->under = 0;
+}
+
+int vgovern_frame(vgovern *g, float ms)
+{
+	vgovern_config *cfg = &g->config;
+
+	g->frame++;
+	g->ms = g->frame == 1 ? ms : g->ms + (ms - g->ms) * 0.25f;
+
+	if (g->ms > cfg->budget)
+	{
+		g->over++;
+		g->under = 0;
+	}
+	else if (g->ms < cfg->budget * cfg->headroom)
+	{
+		g->under++;
+		g->over = 0;
+	}
+	else
+	{
+		g->over = 0;
+		g->under = 0;
+	}
+
+	if (g->over >= cfg->down_frames && g->level < g->max_level)
+	{
+		/* the last step up did not hold, be slower to try again */
+		if (g->last_up && g->frame - g->last_up < g->up_wait)
+		{
+			if (g->up_wait < cfg->up_frames * VGOVERN_MAX_WAIT)
+				g->up_wait *= 2;
+		}
+		else
+		{
+			g->up_wait = cfg->up_frames;
+		}
+
+		change(g, g->level + 1);
+	}
+	else if (g->under >= g->up_wait && g->level > 0)
+	{
+		g->last_up = g->frame;
+		change(g, g->level - 1);
+	}
+
+	return g->level;
+}
+
+void vgovern_write(const vgovern *g, FILE *f)
+{
+	uint32_t first = g->change_cnt > VGOVERN_HISTORY ? g->change_cnt - VGOVERN_HISTORY : 0;
+
+	fprintf(f, "quality level %d, %u changes in %u frames\n", g->level, g->change_cnt, g->frame);
+
+	for (uint32_t i = first; i < g->change_cnt; i++)
+	{
+		const vgovern_change *c = &g->history[i % VGOVERN_HISTORY];
+
+		fprintf(f, "  frame %8u  level %u -> %u  render %.2f ms\n", c->frame, c->from, c->to, c->ms);
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef __VGOVERN_H
+#define __VGOVERN_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+enum
+{
+	VGOVERN_HISTORY = 64, /* level changes kept */
+	VGOVERN_MAX_WAIT = 32 /* longest up_wait, in multiples of up_frames */
+};
+
+typedef struct
+{
+	float budget;         /* render time allowed per frame in ms */
+	float headroom;       /* step up while below budget * headroom */
+	uint32_t down_frames; /* frames over budget before stepping down */
+	uint32_t up_frames;   /* frames with headroom before stepping up */
+} vgovern_config;
+
+/* a level change */
+typedef struct
+{
+	uint32_t frame;
+	uint8_t from, to;
+	float ms;             /* smoothed render time at the change */
+} vgovern_change;
+
+/* picks a quality level from the time frames take to render. level 0 is
+ * full quality, each level above gives up some more.
+ *
+ * the render time is smoothed, a few frames over budget step down and a
+ * longer run of frames well under it steps back up. the gap between the
+ * two thresholds and the longer wait to step up are the hysteresis. a step
+ * up that gets undone right away doubles the wait before the next try, so
+ * a scene that sits right at the edge does not flip between two levels.
+ */
+typedef struct
+{
+	vgovern_config config;
+
+	int level;
+	int max_level;
+	float ms;             /* smoothed render time */
+
+	uint32_t frame;
+	uint32_t over;        /* consecutive frames over budget */
+	uint32_t under;       /* consecutive frames with headroom */
+	uint32_t up_wait;     /* frames with headroom needed to step up */
+	uint32_t last_up;     /* frame of the last step up */
+
+	uint32_t change_cnt;  /* changes so far, the last few are kept */
+	vgovern_change history[VGOVERN_HISTORY];
+} vgovern;
+
+void vgovern_init(vgovern *g, int max_level, float budget);
+
+/* account for a frame that took ms to render. returns the level to use
+ * from the next frame on.
+ */
+int vgovern_frame(vgovern *g, float ms);
+
+/* print the kept level changes, oldest first */
+void vgovern_write(const vgovern *g, FILE *f);
+
+#endif
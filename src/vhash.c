@@ -0,0 +1,177 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vhash.h"
+#include "emu\vecx.h"
+#include "emu\vlist.h"
+
+static const char header_magic[8] = { 'V', 'E', 'C', 'H', 'A', 'S', 'H', 0 };
+
+static uint64_t step(uint64_t h, uint64_t w)
+{
+	h ^= w;
+	h *= 0x9e3779b97f4a7c15ULL;
+	return h ^ (h >> 32);
+}
+
+static uint64_t mix64(uint64_t x)
+{
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t load64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64_t vhash_frame(const vecx *vecx, const vlist *list)
+{
+	const M6809 *cpu = &vecx->CPU;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t cnt = list->cnt;
+	size_t i;
+
+	h = step(h, cnt);
+
+	for (i = 0; i < cnt; i++)
+	{
+		h = step(h, (uint64_t)list->x0[i] |
+			(uint64_t)list->y0[i] << 16 |
+			(uint64_t)list->x1[i] << 32 |
+			(uint64_t)list->y1[i] << 48);
+	}
+
+	/* colors eight at a time, the tail padded with zeros */
+	for (i = 0; i + 8 <= cnt; i += 8)
+		h = step(h, load64(&list->color[i]));
+
+	if (i < cnt)
+	{
+		uint8_t tail[8] = { 0 };
+		memcpy(tail, &list->color[i], cnt - i);
+		h = step(h, load64(tail));
+	}
+
+	h = step(h, (uint64_t)cpu->reg_x | (uint64_t)cpu->reg_y << 16 |
+		(uint64_t)cpu->reg_u << 32 | (uint64_t)cpu->reg_s << 48);
+	h = step(h, (uint64_t)cpu->reg_pc | (uint64_t)cpu->reg_a << 16 |
+		(uint64_t)cpu->reg_b << 24 | (uint64_t)cpu->reg_dp << 32 |
+		(uint64_t)cpu->reg_cc << 40 | (uint64_t)cpu->irq_status << 48);
+
+	for (i = 0; i < sizeof(vecx->ram); i += 8)
+		h = step(h, load64(&vecx->ram[i]));
+
+	return mix64(h);
+}
+
+int vhash_open(vhash_log *log, const char *name)
+{
+	log->frames = 0;
+
+	if (!(log->file = fopen(name, "wb")))
+	{
+		perror(name);
+		return 0;
+	}
+
+	fwrite(header_magic, 1, sizeof(header_magic), log->file);
+	return 1;
+}
+
+void vhash_write(vhash_log *log, uint64_t hash)
+{
+	uint8_t b[8];
+
+	if (!log->file)
+		return;
+
+	for (int i = 0; i < 8; i++)
+		b[i] = (uint8_t)(hash >> (8 * i));
+
+	fwrite(b, 1, sizeof(b), log->file);
+	log->frames++;
+}
+
+void vhash_close(vhash_log *log)
+{
+	if (log->file)
+		fclose(log->file);
+
+	log->file = NULL;
+}
+
+static FILE *open_log(const char *name)
+{
+	char magic[8];
+	FILE *f = fopen(name, "rb");
+
+	if (!f)
+	{
+		perror(name);
+		return NULL;
+	}
+
+	if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+		memcmp(magic, header_magic, sizeof(magic)) != 0)
+	{
+		fprintf(stderr, "%s: not a hash log\n", name);
+		fclose(f);
+		return NULL;
+	}
+
+	return f;
+}
+
+int vhash_compare(const char *name_a, const char *name_b)
+{
+	FILE *a = open_log(name_a);
+	FILE *b = open_log(name_b);
+	uint8_t ha[8], hb[8];
+	uint32_t frame = 0;
+	int same = 0;
+
+	while (a && b)
+	{
+		size_t na = fread(ha, 1, sizeof(ha), a);
+		size_t nb = fread(hb, 1, sizeof(hb), b);
+
+		if (na < sizeof(ha) || nb < sizeof(hb))
+		{
+			if (na == nb)
+			{
+				printf("identical for %u frames\n", frame);
+				same = 1;
+			}
+			else
+			{
+				printf("identical for %u frames, then %s ends\n",
+					frame, na < sizeof(ha) ? name_a : name_b);
+			}
+			break;
+		}
+
+		if (memcmp(ha, hb, sizeof(ha)) != 0)
+		{
+			printf("runs diverge at frame %u\n", frame);
+			break;
+		}
+
+		frame++;
+	}
+
+	if (a)
+		fclose(a);
+	if (b)
+		fclose(b);
+
+	return same;
+}
@@ -0,0 +1,38 @@
+#ifndef __VHASH_H
+#define __VHASH_H
+
+#include <stdio.h>
+
+#include "emu\vecx.h"
+#include "emu\vlist.h"
+
+/* hash logs hold a 64 bit hash per emulated frame so two runs can be
+ * compared without keeping their output around. all integers are little
+ * endian.
+ *
+ *   header   "VECHASH" 0x00
+ *   frames   u64 hash, one per frame starting with the first one
+ *
+ * a frame's hash covers its vectors in emission order plus the cpu
+ * registers and ram at the end of the frame. the sound chip is left out,
+ * its counters are advanced by the audio thread.
+ */
+
+typedef struct
+{
+	FILE *file;
+	uint32_t frames;
+} vhash_log;
+
+uint64_t vhash_frame(const vecx *vecx, const vlist *list);
+
+int vhash_open(vhash_log *log, const char *name);
+void vhash_write(vhash_log *log, uint64_t hash);
+void vhash_close(vhash_log *log);
+
+/* compare two logs and print the first frame they differ at. returns 1 if
+ * they are the same.
+ */
+int vhash_compare(const char *name_a, const char *name_b);
+
+#endif
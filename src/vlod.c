@@ -0,0 +1,195 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vlod.h"
+#include "emu\vlist.h"
+
+enum
+{
+	/* brightest color a collapsed vector can reach, VECTREX_COLORS - 1 */
+	VLOD_MAX_COLOR = 127,
+
+	/* points inside a run that are checked against its line, a run ends
+	 * when they run out
+	 */
+	VLOD_MAX_JOINTS = 32
+};
+
+/* the run of vectors being collapsed */
+typedef struct
+{
+	int32_t sx, sy; /* start of the first vector */
+	int32_t ex, ey; /* end of the last one */
+	uint32_t cnt;
+	uint32_t sum;   /* of the colors */
+	uint8_t color;  /* of the first vector, kept if it stays alone */
+	uint16_t t;     /* when the last vector ended */
+
+	/* the points the run passes through between its start and end */
+	uint32_t joints;
+	int32_t jx[VLOD_MAX_JOINTS], jy[VLOD_MAX_JOINTS];
+} chain;
+
+static int32_t iabs(int32_t v)
+{
+	return v < 0 ? -v : v;
+}
+
+int vlod_init(vlod *lod)
+{
+	memset(lod, 0, sizeof(*lod));
+
+	lod->config.quant = 1;
+	lod->config.max_len = 4;
+
+	lod->out = malloc(sizeof(vlist));
+
+	if (!lod->out)
+		return 0;
+
+	vlist_clear(lod->out);
+	return 1;
+}
+
+void vlod_done(vlod *lod)
+{
+	free(lod->out);
+	memset(lod, 0, sizeof(*lod));
+}
+
+static void flush(vlist *out, const chain *c, int32_t quant)
+{
+	uint32_t pixels, sum;
+
+	if (c->cnt == 1)
+	{
+		vlist_add(out, c->sx, c->sy, c->ex, c->ey, c->color, c->t);
+		return;
+	}
+
+	/* the collapsed vectors each lit about one pixel */
+	pixels = (uint32_t)(iabs(c->ex - c->sx) > iabs(c->ey - c->sy) ?
+		iabs(c->ex - c->sx) : iabs(c->ey - c->sy)) / (uint32_t)quant + 1;
+	sum = c->sum / pixels;
+
+	vlist_add(out, c->sx, c->sy, c->ex, c->ey,
+		(uint8_t)(sum > VLOD_MAX_COLOR ? VLOD_MAX_COLOR : sum), c->t);
+}
+
+/* is x, y within half a pixel of the line from the start of the chain
+ * along dx, dy? compared squared: |d x j| / |d| <= quant / 2
+ */
+static int near(const chain *c, int64_t dx, int64_t dy, int32_t x, int32_t y, int64_t tol)
+{
+	int64_t jx = x - c->sx, jy = y - c->sy;
+	int64_t cross = dx * jy - dy * jx;
+
+	return cross * cross <= tol * tol * (dx * dx + dy * dy);
+}
+
+/* can the chain be extended by the vector from x0, y0 to x1, y1? every point
+ * of the run so far has to stay near the new straight line, not just the
+ * last one, or a run that bends slowly drifts off it.
+ */
+static int fits(const chain *c, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t quant, int32_t max_len)
+{
+	int64_t dx = x1 - c->sx, dy = y1 - c->sy;
+	int64_t tol = quant / 2;
+
+	if (iabs((int32_t)dx) > max_len || iabs((int32_t)dy) > max_len)
+		return 0;
+
+	if (c->joints + 2 > VLOD_MAX_JOINTS)
+		return 0;
+
+	if (!near(c, dx, dy, c->ex, c->ey, tol) || !near(c, dx, dy, x0, y0, tol))
+		return 0;
+
+	for (uint32_t i = 0; i < c->joints; i++)
+	{
+		if (!near(c, dx, dy, c->jx[i], c->jy[i], tol))
+			return 0;
+	}
+
+	return 1;
+}
+
+static void add_joint(chain *c, int32_t x, int32_t y)
+{
+	c->jx[c->joints] = x;
+	c->jy[c->joints] = y;
+	c->joints++;
+}
+
+const vlist *vlod_run(vlod *lod, const vlist *in)
+{
+	int32_t quant = lod->config.quant > 0 ? lod->config.quant : 1;
+	int32_t max_len = (int32_t)lod->config.max_len * quant;
+	vlod_stats *stats = &lod->stats;
+	vlist *out = lod->out;
+	chain c = { 0 };
+
+	vlist_clear(out);
+	out->start = in->start;
+	out->cycles = in->cycles;
+	memset(stats, 0, sizeof(*stats));
+	stats->in = (uint32_t)in->cnt;
+
+	for (size_t i = 0; i < in->cnt; i++)
+	{
+		int32_t x0 = in->x0[i], y0 = in->y0[i];
+		int32_t x1 = in->x1[i], y1 = in->y1[i];
+		uint8_t color = in->color[i];
+		int sub = iabs(x1 - x0) < quant && iabs(y1 - y0) < quant;
+
+		/* blanked gaps shorter than a pixel do not show either, the run
+		 * may continue across them.
+		 */
+		if (c.cnt && sub && iabs(x0 - c.ex) < quant && iabs(y0 - c.ey) < quant &&
+			fits(&c, x0, y0, x1, y1, quant, max_len))
+		{
+			/* a blanked gap leaves two points behind */
+			add_joint(&c, c.ex, c.ey);
+			if (x0 != c.ex || y0 != c.ey)
+				add_joint(&c, x0, y0);
+
+			c.ex = x1;
+			c.ey = y1;
+			c.cnt++;
+			c.sum += color;
+			c.t = in->t[i];
+			stats->collapsed++;
+			continue;
+		}
+
+		if (c.cnt)
+		{
+			flush(out, &c, quant);
+			c.cnt = 0;
+		}
+
+		if (sub)
+		{
+			c.sx = x0;
+			c.sy = y0;
+			c.ex = x1;
+			c.ey = y1;
+			c.cnt = 1;
+			c.joints = 0;
+			c.sum = color;
+			c.color = color;
+			c.t = in->t[i];
+		}
+		else
+		{
+			vlist_add(out, x0, y0, x1, y1, color, in->t[i]);
+		}
+	}
+
+	if (c.cnt)
+		flush(out, &c, quant);
+
+	stats->out = (uint32_t)out->cnt;
+	return out;
+}
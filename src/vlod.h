@@ -0,0 +1,46 @@
+#ifndef __VLOD_H
+#define __VLOD_H
+
+#include "emu\vlist.h"
+
+typedef struct
+{
+	int32_t quant;      /* dac units per pixel of the output */
+	uint32_t max_len;   /* longest collapsed primitive in pixels */
+} vlod_config;
+
+/* what happened to the last frame */
+typedef struct
+{
+	uint32_t in;
+	uint32_t collapsed; /* folded into the chain before them */
+	uint32_t out;
+} vlod_stats;
+
+/* level of detail for a given output resolution. runs of vectors shorter
+ * than a pixel, each starting less than a pixel from where the last one
+ * ended, are collapsed into a single vector from the start of the run to
+ * its end, as long as every point the run passes through stays within half
+ * a pixel of that straight line. the intensity of the collapsed vectors is
+ * summed and spread over the pixels the result covers.
+ *
+ * each output keeps its own instance, a thumbnail and a high resolution
+ * export want different results from the same frame.
+ */
+typedef struct
+{
+	vlod_config config;
+	vlod_stats stats;
+
+	vlist *out;
+} vlod;
+
+int vlod_init(vlod *lod);
+void vlod_done(vlod *lod);
+
+/* run a frame through the stage. the result stays valid until the next
+ * call.
+ */
+const vlist *vlod_run(vlod *lod, const vlist *in);
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vprof.h"
+#include "emu\vlist.h"
+
+enum
+{
+	VPROF_ADDRS = 0x10000,
+
+	/* lines per table in the report */
+	VPROF_TOP = 32
+};
+
+int vprof_init(vprof *prof)
+{
+	memset(prof, 0, sizeof(*prof));
+
+	prof->pc = calloc(VPROF_ADDRS, sizeof(vprof_entry));
+	prof->caller = calloc(VPROF_ADDRS, sizeof(vprof_entry));
+
+	if (!prof->pc || !prof->caller)
+	{
+		vprof_done(prof);
+		return 0;
+	}
+
+	return 1;
+}
+
+void vprof_done(vprof *prof)
+{
+	free(prof->pc);
+	free(prof->caller);
+	memset(prof, 0, sizeof(*prof));
+}
+
+void vprof_frame(vprof *prof, const vlist *list)
+{
+	if (!list->traced)
+		return;
+
+	for (size_t i = 0; i < list->cnt; i++)
+	{
+		vprof_entry *pc = &prof->pc[list->pc[i]];
+		vprof_entry *caller = &prof->caller[list->caller[i]];
+
+		pc->segments++;
+		pc->beam += list->beam[i];
+		caller->segments++;
+		caller->beam += list->beam[i];
+		prof->beam += list->beam[i];
+	}
+
+	prof->frames++;
+	prof->segments += (uint32_t)list->cnt;
+}
+
+static const vprof_entry *sort_table;
+
+static int by_beam(const void *a, const void *b)
+{
+	const vprof_entry *ea = &sort_table[*(const uint16_t *)a];
+	const vprof_entry *eb = &sort_table[*(const uint16_t *)b];
+
+	if (ea->beam != eb->beam)
+		return ea->beam < eb->beam ? 1 : -1;
+	if (ea->segments != eb->segments)
+		return ea->segments < eb->segments ? 1 : -1;
+	return 0;
+}
+
+static void write_table(FILE *f, const vprof *prof, const vprof_entry *table, const char *title)
+{
+	static uint16_t addrs[VPROF_ADDRS];
+	size_t cnt = 0;
+
+	for (size_t a = 0; a < VPROF_ADDRS; a++)
+	{
+		if (table[a].segments)
+			addrs[cnt++] = (uint16_t)a;
+	}
+
+	sort_table = table;
+	qsort(addrs, cnt, sizeof(addrs[0]), by_beam);
+
+	fprintf(f, "\n%s\n", title);
+	fprintf(f, "addr   segments  seg/frame   beam cycles  beam/frame  beam%%\n");
+
+	for (size_t i = 0; i < cnt && i < VPROF_TOP; i++)
+	{
+		const vprof_entry *e = &table[addrs[i]];
+
+		fprintf(f, "%04x %10u %10.1f %13llu %11.1f %6.2f\n",
+			addrs[i], e->segments, (double)e->segments / prof->frames,
+			(unsigned long long)e->beam, (double)e->beam / prof->frames,
+			prof->beam ? 100.0 * (double)e->beam / (double)prof->beam : 0.0);
+	}
+}
+
+int vprof_write(const vprof *prof, const char *name)
+{
+	FILE *f = strcmp(name, "-") == 0 ? stdout : fopen(name, "w");
+
+	if (!f)
+		return 0;
+
+	fprintf(f, "%u frames, %u segments, %llu beam cycles\n",
+		prof->frames, prof->segments, (unsigned long long)prof->beam);
+
+	if (prof->frames)
+	{
+		write_table(f, prof, prof->pc, "by program counter");
+		write_table(f, prof, prof->caller, "by caller (word on top of the stack, 0000 if outside ram)");
+	}
+
+	if (f != stdout)
+		fclose(f);
+
+	return 1;
+}
@@ -0,0 +1,37 @@
+#ifndef __VPROF_H
+#define __VPROF_H
+
+#include <stdint.h>
+
+#include "emu\vlist.h"
+
+/* totals for one 6809 address */
+typedef struct
+{
+	uint32_t segments; /* vectors started there */
+	uint64_t beam;     /* 6809 cycles the beam was on for them */
+} vprof_entry;
+
+/* sums up where a game's vectors come from over many traced frames */
+typedef struct
+{
+	uint32_t frames;
+	uint32_t segments;
+	uint64_t beam;
+
+	vprof_entry *pc;     /* indexed by the program counter */
+	vprof_entry *caller; /* indexed by the word on top of the stack */
+} vprof;
+
+int vprof_init(vprof *prof);
+void vprof_done(vprof *prof);
+
+/* add a frame, ignored unless its vectors were traced */
+void vprof_frame(vprof *prof, const vlist *list);
+
+/* write the busiest addresses, the ones with the most beam time first.
+ * name "-" writes to stdout.
+ */
+int vprof_write(const vprof *prof, const char *name);
+
+#endif
@@ -0,0 +1,657 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "vraster.h"
+#include "emu\vlist.h"
+#include "emu\vecx.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VRASTER_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+/* brightest vectrex color, VECTREX_COLORS - 1 */
+#define VRASTER_MAX_COLOR 127.0f
+
+/* halves the picture every 1 / VECTREX_PDECAY seconds, like the alpha 128
+ * fade of the other renderers
+ */
+#define VRASTER_TAU (1.0f / (VECTREX_PDECAY * 0.693147f))
+
+/* fold level into the buffer before the stored values grow past this */
+#define VRASTER_MIN_LEVEL (1.0f / 4096.0f)
+
+int vraster_init(vraster *r, int width, int height)
+{
+	memset(r, 0, sizeof(*r));
+
+	r->config.xform.ax = 1.0f;
+	r->config.xform.by = 1.0f;
+	r->config.gain = 1.0f;
+	r->config.tau = VRASTER_TAU;
+	r->level = 1.0f;
+
+	r->simd = VRASTER_SCALAR;
+#ifdef VRASTER_X86
+	if (SDL_HasSSE2())
+		r->simd = VRASTER_SSE2;
+	if (SDL_HasAVX2())
+		r->simd = VRASTER_AVX2;
+#endif
+
+	return vraster_resize(r, width, height);
+}
+
+static void free_buffers(vraster *r)
+{
+	free(r->accum);
+	free(r->pixels);
+
+	if (r->bins)
+	{
+		for (int t = 0; t < r->tiles_x * r->tiles_y; t++)
+			free(r->bins[t].idx);
+	}
+
+	free(r->bins);
+
+	r->accum = NULL;
+	r->origin = NULL;
+	r->pixels = NULL;
+	r->bins = NULL;
+	r->tiles_x = r->tiles_y = 0;
+}
+
+void vraster_done(vraster *r)
+{
+	vraster_threads(r, 1);
+	free_buffers(r);
+}
+
+int vraster_resize(vraster *r, int width, int height)
+{
+	/* rows padded to whole AVX2 vectors */
+	int stride = (width + 2 * VRASTER_GUARD + 7) & ~7;
+	size_t rows = (size_t)height + 2 * VRASTER_GUARD;
+
+	free_buffers(r);
+
+	if (width <= 0 || height <= 0)
+	{
+		/* nothing to draw into yet */
+		r->width = r->height = 0;
+		return 1;
+	}
+
+	r->level = 1.0f;
+	r->renorm = 0;
+
+	r->width = width;
+	r->height = height;
+	r->stride = stride;
+	r->accum = calloc(rows * stride, sizeof(float));
+	r->pixels = malloc((size_t)width * height * sizeof(uint32_t));
+
+	r->tiles_x = (width + VRASTER_TILE_W - 1) / VRASTER_TILE_W;
+	r->tiles_y = (height + VRASTER_TILE_H - 1) / VRASTER_TILE_H;
+	r->bins = calloc((size_t)r->tiles_x * r->tiles_y, sizeof(vraster_bin));
+
+	if (!r->accum || !r->pixels || !r->bins)
+	{
+		free_buffers(r);
+		return 0;
+	}
+
+	r->origin = r->accum + VRASTER_GUARD * stride + VRASTER_GUARD;
+	return 1;
+}
+
+/* the pixels a line may write to, x0 <= x < x1 and y0 <= y < y1 */
+typedef struct
+{
+	int x0, y0;
+	int x1, y1;
+} clip_rect;
+
+static void plot(float *origin, int stride, const clip_rect *clip, int x, int y, float c)
+{
+	if (x >= clip->x0 && x < clip->x1 && y >= clip->y0 && y < clip->y1)
+		origin[y * stride + x] += c;
+}
+
+/* spread c over the four pixels around x, y */
+static void splat(float *origin, int stride, const clip_rect *clip, float x, float y, float c)
+{
+	int xi = (int)floorf(x - 0.5f);
+	int yi = (int)floorf(y - 0.5f);
+	float fx = x - 0.5f - xi;
+	float fy = y - 0.5f - yi;
+
+	plot(origin, stride, clip, xi, yi, c * (1.0f - fx) * (1.0f - fy));
+	plot(origin, stride, clip, xi + 1, yi, c * fx * (1.0f - fy));
+	plot(origin, stride, clip, xi, yi + 1, c * (1.0f - fx) * fy);
+	plot(origin, stride, clip, xi + 1, yi + 1, c * fx * fy);
+}
+
+/* Wu line. along the major axis each pixel column gets c times the length
+ * of the line inside it, split between the two pixels nearest to the line.
+ */
+static void wu_line(float *origin, int stride, const clip_rect *clip,
+	float x0, float y0, float x1, float y1, float c)
+{
+	int major = 1, minor = stride;
+	int lo_major = clip->x0, hi_major = clip->x1;
+	int lo_minor = clip->y0, hi_minor = clip->y1;
+	float dx, g;
+	int xa, xb;
+
+	if (fabsf(y1 - y0) > fabsf(x1 - x0))
+	{
+		float t;
+		t = x0; x0 = y0; y0 = t;
+		t = x1; x1 = y1; y1 = t;
+		major = stride;
+		minor = 1;
+		lo_major = clip->y0;
+		hi_major = clip->y1;
+		lo_minor = clip->x0;
+		hi_minor = clip->x1;
+	}
+
+	if (x0 > x1)
+	{
+		float t;
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+	}
+
+	dx = x1 - x0;
+
+	if (dx < 1.0f)
+	{
+		/* shorter than a pixel, draw it like a point */
+		float mx = (x0 + x1) * 0.5f, my = (y0 + y1) * 0.5f;
+
+		if (major == 1)
+			splat(origin, stride, clip, mx, my, c);
+		else
+			splat(origin, stride, clip, my, mx, c);
+		return;
+	}
+
+	g = (y1 - y0) / dx;
+	xa = (int)floorf(x0);
+	xb = (int)floorf(x1);
+
+	/* only walk the part of the line that can reach the clip rect across */
+	if (g != 0.0f)
+	{
+		float sa = x0 + ((float)lo_minor - 1.0f - y0) / g;
+		float sb = x0 + ((float)hi_minor + 1.0f - y0) / g;
+		float smin = sa < sb ? sa : sb;
+		float smax = sa < sb ? sb : sa;
+
+		if (smin > (float)xa)
+			xa = (int)floorf(smin);
+		if (smax < (float)xb)
+			xb = (int)floorf(smax);
+	}
+	else if (y0 < (float)lo_minor - 1.0f || y0 > (float)hi_minor + 1.0f)
+	{
+		return;
+	}
+
+	if (xa < lo_major)
+		xa = lo_major;
+	if (xb > hi_major - 1)
+		xb = hi_major - 1;
+
+	for (int x = xa; x <= xb; x++)
+	{
+		float lo = x > x0 ? (float)x : x0;
+		float hi = x + 1 < x1 ? (float)(x + 1) : x1;
+		float y = y0 + g * ((lo + hi) * 0.5f - x0) - 0.5f;
+		int yi = (int)floorf(y);
+		float f = y - yi;
+		float w = c * (hi - lo);
+		float *p = origin + x * major + yi * minor;
+
+		if (yi >= lo_minor && yi < hi_minor)
+			p[0] += w * (1.0f - f);
+		if (yi + 1 >= lo_minor && yi + 1 < hi_minor)
+			p[minor] += w * f;
+	}
+}
+
+/* vector v of the list in pixels */
+static void vector_pixels(const vraster *r, const vlist *list, size_t v, float *p)
+{
+	const vview_xform *m = &r->config.xform;
+	float maxx = (float)r->width, maxy = (float)r->height;
+	float x0 = list->x0[v], y0 = list->y0[v];
+	float x1 = list->x1[v], y1 = list->y1[v];
+
+	p[0] = m->ax * x0 + m->bx * y0 + m->cx;
+	p[1] = m->ay * x0 + m->by * y0 + m->cy;
+	p[2] = m->ax * x1 + m->bx * y1 + m->cx;
+	p[3] = m->ay * x1 + m->by * y1 + m->cy;
+
+	/* the dac stays inside its range, but rounding and odd transforms must
+	 * not reach past the guard
+	 */
+	p[0] = p[0] < 0.0f ? 0.0f : p[0] < maxx ? p[0] : maxx;
+	p[1] = p[1] < 0.0f ? 0.0f : p[1] < maxy ? p[1] : maxy;
+	p[2] = p[2] < 0.0f ? 0.0f : p[2] < maxx ? p[2] : maxx;
+	p[3] = p[3] < 0.0f ? 0.0f : p[3] < maxy ? p[3] : maxy;
+}
+
+static float time_constant(const vraster *r)
+{
+	/* 0 turns the persistence off, close enough */
+	return r->config.tau > 1e-4f ? r->config.tau : 1e-4f;
+}
+
+/* brightness of vector v at the end of the frame, in stored units */
+static float vector_weight(const vraster *r, const vlist *list, size_t v)
+{
+	float c = list->color[v] * r->config.gain / (VRASTER_MAX_COLOR * r->level);
+
+	if (list->cycles && list->t[v] < list->cycles)
+	{
+		float age = (float)(list->cycles - list->t[v]) / VECTREX_MHZ;
+		c *= expf(-age / time_constant(r));
+	}
+
+	return c;
+}
+
+static void draw_all(vraster *r, const vlist *list, size_t first)
+{
+	clip_rect clip;
+
+	clip.x0 = -VRASTER_GUARD;
+	clip.y0 = -VRASTER_GUARD;
+	clip.x1 = r->width + VRASTER_GUARD;
+	clip.y1 = r->height + VRASTER_GUARD;
+
+	for (size_t v = first; v < list->cnt; v++)
+	{
+		float p[4];
+
+		vector_pixels(r, list, v, p);
+		wu_line(r->origin, r->stride, &clip, p[0], p[1], p[2], p[3], vector_weight(r, list, v));
+	}
+}
+
+/* pixels are the stored values times level. with renorm the buffer takes
+ * the scaled values, level starts over at 1 afterwards.
+ */
+static void resolve_scalar(float *a, uint32_t *out, int n, float level, int renorm)
+{
+	for (int i = 0; i < n; i++)
+	{
+		float v = a[i] * level;
+		uint32_t g = (uint32_t)lrintf((v < 1.0f ? v : 1.0f) * 255.0f);
+
+		out[i] = 0xff000000u | g << 16 | g << 8 | g;
+		if (renorm)
+			a[i] = v;
+	}
+}
+
+#ifdef VRASTER_X86
+TARGET_SSE2 static int resolve_sse2(float *a, uint32_t *out, int n, float level, int renorm)
+{
+	__m128 l = _mm_set1_ps(level);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 k = _mm_set1_ps(255.0f);
+	__m128i alpha = _mm_set1_epi32((int)0xff000000u);
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(a + i), l);
+		__m128i g = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(v, one), k));
+
+		g = _mm_or_si128(_mm_or_si128(g, _mm_slli_epi32(g, 8)), _mm_slli_epi32(g, 16));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(g, alpha));
+		if (renorm)
+			_mm_storeu_ps(a + i, v);
+	}
+
+	return i;
+}
+
+TARGET_AVX2 static int resolve_avx2(float *a, uint32_t *out, int n, float level, int renorm)
+{
+	__m256 l = _mm256_set1_ps(level);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 k = _mm256_set1_ps(255.0f);
+	__m256i alpha = _mm256_set1_epi32((int)0xff000000u);
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_mul_ps(_mm256_loadu_ps(a + i), l);
+		__m256i g = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(v, one), k));
+
+		g = _mm256_or_si256(_mm256_or_si256(g, _mm256_slli_epi32(g, 8)), _mm256_slli_epi32(g, 16));
+		_mm256_storeu_si256((__m256i *)(out + i), _mm256_or_si256(g, alpha));
+		if (renorm)
+			_mm256_storeu_ps(a + i, v);
+	}
+
+	return i;
+}
+#endif
+
+static void resolve_span(const vraster *r, float *row, uint32_t *out, int n)
+{
+	int done = 0;
+
+#ifdef VRASTER_X86
+	if (r->simd == VRASTER_AVX2)
+		done = resolve_avx2(row, out, n, r->level, r->renorm);
+	else if (r->simd == VRASTER_SSE2)
+		done = resolve_sse2(row, out, n, r->level, r->renorm);
+#endif
+	resolve_scalar(row + done, out + done, n - done, r->level, r->renorm);
+}
+
+static void resolve_all(vraster *r)
+{
+	/* lines spill into the guard, it is drawn to but never shown */
+	for (int y = -VRASTER_GUARD; y < r->height + VRASTER_GUARD; y++)
+	{
+		float *row = r->origin + y * r->stride;
+
+		if (y < 0 || y >= r->height)
+		{
+			memset(row - VRASTER_GUARD, 0, r->stride * sizeof(float));
+			continue;
+		}
+
+		for (int g = 1; g <= VRASTER_GUARD; g++)
+		{
+			row[-g] = 0.0f;
+			row[r->width + g - 1] = 0.0f;
+		}
+
+		resolve_span(r, row, r->out + (size_t)y * r->pitch, r->width);
+	}
+}
+
+static void bin_add(vraster_bin *bin, uint32_t v)
+{
+	if (bin->cnt == bin->max)
+	{
+		uint32_t max = bin->max ? 2 * bin->max : 64;
+		uint32_t *idx = realloc(bin->idx, max * sizeof(uint32_t));
+
+		if (!idx)
+			return;
+
+		bin->idx = idx;
+		bin->max = max;
+	}
+
+	bin->idx[bin->cnt++] = v;
+}
+
+/* put every vector into the tiles it can write to. the line is cut into
+ * slabs one tile column wide, each slab covering the tile rows its part of
+ * the line reaches. the margin covers the anti-aliasing and splats.
+ */
+static void bin_vectors(vraster *r, const vlist *list, size_t first)
+{
+	const float margin = 2.0f;
+	const float tile_w = (float)VRASTER_TILE_W;
+	const float tile_h = (float)VRASTER_TILE_H;
+
+	for (int t = 0; t < r->tiles_x * r->tiles_y; t++)
+		r->bins[t].cnt = 0;
+
+	for (size_t v = first; v < list->cnt; v++)
+	{
+		float p[4];
+		float xl, xh, g;
+		int tx0, tx1;
+
+		vector_pixels(r, list, v, p);
+
+		if (p[0] > p[2])
+		{
+			float t;
+			t = p[0]; p[0] = p[2]; p[2] = t;
+			t = p[1]; p[1] = p[3]; p[3] = t;
+		}
+
+		xl = p[0] - margin;
+		xh = p[2] + margin;
+		g = p[2] - p[0] > 0.0f ? (p[3] - p[1]) / (p[2] - p[0]) : 0.0f;
+
+		tx0 = xl < 0.0f ? 0 : (int)(xl / tile_w);
+		tx1 = (int)(xh / tile_w);
+		if (tx1 >= r->tiles_x)
+			tx1 = r->tiles_x - 1;
+
+		for (int tx = tx0; tx <= tx1; tx++)
+		{
+			/* the part of the line over this tile column */
+			float sa = tx * tile_w - margin, sb = (tx + 1) * tile_w + margin;
+			float a = sa > p[0] ? sa : p[0];
+			float b = sb < p[2] ? sb : p[2];
+			float ya = p[1] + g * (a - p[0]);
+			float yb = p[1] + g * (b - p[0]);
+			float yl, yh;
+			int ty0, ty1;
+
+			if (g == 0.0f)
+			{
+				/* vertical, or a point */
+				ya = p[1];
+				yb = p[3];
+			}
+
+			yl = (ya < yb ? ya : yb) - margin;
+			yh = (ya < yb ? yb : ya) + margin;
+
+			ty0 = yl < 0.0f ? 0 : (int)(yl / tile_h);
+			ty1 = (int)(yh / tile_h);
+			if (ty1 >= r->tiles_y)
+				ty1 = r->tiles_y - 1;
+
+			for (int ty = ty0; ty <= ty1; ty++)
+				bin_add(&r->bins[ty * r->tiles_x + tx], (uint32_t)v);
+		}
+	}
+}
+
+static void draw_tile(vraster *r, int t)
+{
+	const vlist *list = r->list;
+	const vraster_bin *bin = &r->bins[t];
+	clip_rect clip;
+
+	clip.x0 = (t % r->tiles_x) * VRASTER_TILE_W;
+	clip.y0 = (t / r->tiles_x) * VRASTER_TILE_H;
+	clip.x1 = clip.x0 + VRASTER_TILE_W < r->width ? clip.x0 + VRASTER_TILE_W : r->width;
+	clip.y1 = clip.y0 + VRASTER_TILE_H < r->height ? clip.y0 + VRASTER_TILE_H : r->height;
+
+	for (uint32_t i = 0; i < bin->cnt; i++)
+	{
+		uint32_t v = bin->idx[i];
+		float p[4];
+
+		vector_pixels(r, list, v, p);
+		wu_line(r->origin, r->stride, &clip, p[0], p[1], p[2], p[3], vector_weight(r, list, v));
+	}
+
+	for (int y = clip.y0; y < clip.y1; y++)
+	{
+		resolve_span(r, r->origin + y * r->stride + clip.x0,
+			r->out + (size_t)y * r->pitch + clip.x0, clip.x1 - clip.x0);
+	}
+}
+
+static void run_tiles(vraster *r)
+{
+	int cnt = r->tiles_x * r->tiles_y;
+	int t;
+
+	while ((t = SDL_AtomicAdd(&r->next, 1)) < cnt)
+		draw_tile(r, t);
+}
+
+static int worker(void *data)
+{
+	vraster *r = data;
+
+	for (;;)
+	{
+		SDL_SemWait(r->start);
+
+		if (SDL_AtomicGet(&r->quit))
+			break;
+
+		run_tiles(r);
+		SDL_SemPost(r->done);
+	}
+
+	return 0;
+}
+
+int vraster_threads(vraster *r, int cnt)
+{
+	/* stop the current workers */
+	if (r->thread_cnt > 0)
+	{
+		SDL_AtomicSet(&r->quit, 1);
+
+		for (int i = 0; i < r->thread_cnt; i++)
+			SDL_SemPost(r->start);
+		for (int i = 0; i < r->thread_cnt; i++)
+			SDL_WaitThread(r->threads[i], NULL);
+
+		SDL_DestroySemaphore(r->start);
+		SDL_DestroySemaphore(r->done);
+		r->start = r->done = NULL;
+		r->thread_cnt = 0;
+	}
+
+	if (cnt <= 0)
+		cnt = SDL_GetCPUCount();
+	if (cnt > VRASTER_MAX_THREADS)
+		cnt = VRASTER_MAX_THREADS;
+	if (cnt <= 1)
+		return 1;
+
+	SDL_AtomicSet(&r->quit, 0);
+	r->start = SDL_CreateSemaphore(0);
+	r->done = SDL_CreateSemaphore(0);
+
+	if (!r->start || !r->done)
+		return 0;
+
+	/* the caller is the last of the cnt threads */
+	for (int i = 0; i < cnt - 1; i++)
+	{
+		r->threads[i] = SDL_CreateThread(worker, "raster", r);
+		if (!r->threads[i])
+			break;
+		r->thread_cnt++;
+	}
+
+	return r->thread_cnt == cnt - 1;
+}
+
+/* fade the picture by the time since the last frame ended */
+static void decay(vraster *r, const vlist *list)
+{
+	float tau = time_constant(r);
+	float dt = 1.0f / VECTREX_PDECAY;
+
+	if (list->cycles)
+	{
+		uint32_t end = list->start + list->cycles;
+		uint32_t elapsed = r->timed ? end - r->end : list->cycles;
+
+		/* a reset starts the count over, treat it as a long pause */
+		dt = elapsed <= VECTREX_MHZ ? (float)elapsed / VECTREX_MHZ : 1.0f;
+		r->end = end;
+		r->timed = 1;
+	}
+
+	r->level *= expf(-dt / tau);
+
+	/* the old picture is long gone by then, but the weights divide by it */
+	if (r->level < 1e-20f)
+		r->level = 1e-20f;
+
+	/* the tiles must agree, so decide here rather than while resolving */
+	r->renorm = r->level < VRASTER_MIN_LEVEL;
+}
+
+void vraster_frame(vraster *r, const vlist *list, uint32_t *out, int pitch)
+{
+	vraster_slice(r, list, 0, out, pitch);
+}
+
+void vraster_slice(vraster *r, const vlist *list, size_t first, uint32_t *out, int pitch)
+{
+	if (r->width == 0)
+		return;
+
+	r->out = out ? out : r->pixels;
+	r->pitch = out ? pitch : r->width;
+
+	decay(r, list);
+
+	if (r->thread_cnt == 0)
+	{
+		draw_all(r, list, first);
+		resolve_all(r);
+	}
+	else
+	{
+		bin_vectors(r, list, first);
+		r->list = list;
+
+		SDL_AtomicSet(&r->next, 0);
+
+		for (int i = 0; i < r->thread_cnt; i++)
+			SDL_SemPost(r->start);
+
+		run_tiles(r);
+
+		for (int i = 0; i < r->thread_cnt; i++)
+			SDL_SemWait(r->done);
+	}
+
+	if (r->renorm)
+	{
+		r->level = 1.0f;
+		r->renorm = 0;
+	}
+}
+
+const char *vraster_simd_name(int simd)
+{
+	switch (simd)
+	{
+	case VRASTER_AVX2: return "avx2";
+	case VRASTER_SSE2: return "sse2";
+	default: return "scalar";
+	}
+}
@@ -0,0 +1,129 @@
+#ifndef __VRASTER_H
+#define __VRASTER_H
+
+#include <SDL.h>
+
+#include "vview.h"
+#include "emu\vlist.h"
+
+enum
+{
+	/* untouched pixels around the accumulation buffer so lines can spill
+	 * over the edges without clipping
+	 */
+	VRASTER_GUARD = 2,
+
+	/* tile size in pixels. wide tiles keep the resolve streaming through
+	 * memory, the width is a multiple of the simd width.
+	 */
+	VRASTER_TILE_W = 1024,
+	VRASTER_TILE_H = 32,
+
+	VRASTER_MAX_THREADS = 64
+};
+
+/* vectors touching a tile, in list order */
+typedef struct
+{
+	uint32_t cnt;
+	uint32_t max;
+	uint32_t *idx;
+} vraster_bin;
+
+typedef struct
+{
+	vview_xform xform; /* dac to pixels */
+	float gain;      /* brightness of a full intensity vector */
+	float tau;       /* phosphor time constant in seconds */
+} vraster_config;
+
+/* anti-aliased software rasterizer. vectors are drawn as Wu lines into a
+ * float accumulation buffer which carries over to the next frame, so the
+ * buffer holds the glow of the phosphor.
+ *
+ * the glow fades as exp(-t / tau). rather than scaling every pixel each
+ * frame the buffer is stored divided by level, and only level decays. a
+ * vector is drawn already faded by the time from its emission to the end of
+ * the frame, so the start of a frame is dimmer than its end like on the
+ * tube. once level gets small the resolve folds it back into the buffer.
+ *
+ * resolving turns the buffer into gray ARGB8888 pixels ready for upload.
+ *
+ * the per pixel passes run on AVX2 or SSE2 when the cpu has them.
+ */
+typedef struct
+{
+	vraster_config config;
+
+	int width, height;
+	int stride;        /* floats per accumulation row, guard included */
+	float *accum;      /* allocation, guard included */
+	float *origin;     /* pixel 0, 0 */
+	uint32_t *pixels;  /* width * height resolved pixels */
+	uint32_t *out;     /* where the frame being drawn resolves to */
+	int pitch;         /* pixels per row of out */
+
+	int simd;          /* kernel in use, one of VRASTER_SCALAR... */
+
+	float level;       /* brightness of a stored 1.0 */
+	int renorm;        /* fold level into the buffer while resolving */
+	int timed;         /* is end valid? */
+	uint32_t end;      /* cycle count at the end of the last frame */
+
+	/* with worker threads the frame is split into tiles. the vectors are
+	 * binned into the tiles they cross, then each tile is drawn and
+	 * resolved by whichever thread takes it. a thread only writes inside
+	 * its tile.
+	 */
+	int tiles_x, tiles_y;
+	vraster_bin *bins;
+	const vlist *list;
+
+	int thread_cnt;
+	SDL_Thread *threads[VRASTER_MAX_THREADS];
+	SDL_sem *start;
+	SDL_sem *done;
+	SDL_atomic_t next; /* next tile to take */
+	SDL_atomic_t quit;
+} vraster;
+
+enum
+{
+	VRASTER_SCALAR,
+	VRASTER_SSE2,
+	VRASTER_AVX2
+};
+
+/* a size of 0 leaves allocating to the first vraster_resize */
+int vraster_init(vraster *r, int width, int height);
+void vraster_done(vraster *r);
+
+/* drop the picture and start over at a new size */
+int vraster_resize(vraster *r, int width, int height);
+
+/* draw a frame on cnt threads, the caller being one of them. 0 picks one
+ * per core, 1 draws on the caller only.
+ */
+int vraster_threads(vraster *r, int cnt);
+
+/* decay the picture by the time since the last frame, then draw the frame
+ * and resolve it, on the worker threads if there are any. lists without
+ * timing are taken to last 1 / VECTREX_PDECAY seconds.
+ *
+ * the frame resolves into out, pitch pixels apart, or into pixels if out is
+ * NULL. every pixel of out is written and none is read, so it can point
+ * into a locked texture as long as nothing else reads it back afterwards.
+ * to add glow, resolve into pixels and let vglow_apply write out.
+ */
+void vraster_frame(vraster *r, const vlist *list, uint32_t *out, int pitch);
+
+/* like vraster_frame for a list still being emitted, only the vectors from
+ * first on are drawn, the ones before already were. start and cycles of the
+ * list say how far the frame got, the picture decays up to there.
+ */
+void vraster_slice(vraster *r, const vlist *list, size_t first, uint32_t *out, int pitch);
+
+/* name of a VRASTER_ kernel */
+const char *vraster_simd_name(int simd);
+
+#endif
@@ -0,0 +1,785 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "vstream.h"
+#include "emu\vlist.h"
+
+enum
+{
+	/* worst case size of an encoded vector: tag, color and four three
+	 * byte coordinates
+	 */
+	VSTREAM_VECTOR_MAX = 14,
+
+	/* vector count of the frame that tells the writer thread to finish */
+	VSTREAM_END = VLIST_MAX_CNT + 1,
+
+	VSTREAM_HEADER_SIZE = 12,
+	VSTREAM_TRAILER_SIZE = 20,
+	VSTREAM_INDEX_ENTRY = 12,
+
+	/* bytes per vector in a raw dump */
+	VSTREAM_RAW_VECTOR = 9
+};
+
+static const char header_magic[8] = { 'V', 'E', 'C', 'S', 'T', 'R', 'M', 0 };
+static const char trailer_magic[8] = { 'V', 'S', 'I', 'N', 'D', 'E', 'X', 0 };
+
+static uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		*p++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static uint8_t *put_svarint(uint8_t *p, int32_t v)
+{
+	return put_varint(p, zigzag(v));
+}
+
+static int svarint_len(int32_t v)
+{
+	uint32_t z = zigzag(v);
+	return z < 0x80 ? 1 : z < 0x4000 ? 2 : 3;
+}
+
+static void write_le(FILE *file, uint64_t v, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+		fputc((int)((v >> (8 * i)) & 0xff), file);
+}
+
+static void enc_free(vstream_enc *enc)
+{
+	free(enc->px0);
+	free(enc->py0);
+	free(enc->px1);
+	free(enc->py1);
+	free(enc->pcolor);
+	free(enc->body);
+	free(enc->key_frame);
+	free(enc->key_offset);
+	memset(enc, 0, sizeof(*enc));
+}
+
+int vstream_enc_open(vstream_enc *enc, const char *name)
+{
+	memset(enc, 0, sizeof(*enc));
+
+	enc->px0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	enc->py0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	enc->px1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	enc->py1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	enc->pcolor = malloc(VLIST_MAX_CNT);
+	enc->body = malloc(VLIST_MAX_CNT * VSTREAM_VECTOR_MAX + 16);
+
+	if (!enc->px0 || !enc->py0 || !enc->px1 || !enc->py1 || !enc->pcolor || !enc->body)
+	{
+		enc_free(enc);
+		return 0;
+	}
+
+	if (!(enc->file = fopen(name, "wb")))
+	{
+		perror(name);
+		enc_free(enc);
+		return 0;
+	}
+
+	fwrite(header_magic, 1, sizeof(header_magic), enc->file);
+	write_le(enc->file, VSTREAM_VERSION, 2);
+	write_le(enc->file, VSTREAM_KEY_INTERVAL, 2);
+	enc->offset = sizeof(header_magic) + 4;
+
+	return 1;
+}
+
+void vstream_enc_frame(vstream_enc *enc, const vstream_frame *frame)
+{
+	uint8_t head[16];
+	uint8_t *p = enc->body;
+	uint8_t *h = head;
+	int key = enc->key_cnt == 0 ||
+		frame->frame - enc->key_frame[enc->key_cnt - 1] >= VSTREAM_KEY_INTERVAL;
+	int32_t ex = 0, ey = 0;
+	uint8_t ecolor = 0;
+
+	p = put_varint(p, frame->cnt);
+
+	for (uint32_t i = 0; i < frame->cnt; i++)
+	{
+		int32_t x0 = frame->x0[i], y0 = frame->y0[i];
+		int32_t x1 = frame->x1[i], y1 = frame->y1[i];
+		uint8_t color = frame->color[i];
+		int joined = x0 == ex && y0 == ey;
+		int vertex_len, frame_len = 0x7fffffff;
+		uint8_t tag;
+
+		vertex_len = (color != ecolor) + svarint_len(x1 - x0) + svarint_len(y1 - y0);
+		if (!joined)
+			vertex_len += svarint_len(x0 - ex) + svarint_len(y0 - ey);
+
+		if (!key && i < enc->prev_cnt)
+		{
+			if (x0 == enc->px0[i] && y0 == enc->py0[i] &&
+				x1 == enc->px1[i] && y1 == enc->py1[i] &&
+				color == enc->pcolor[i])
+			{
+				frame_len = -1;
+			}
+			else
+			{
+				frame_len = (color != enc->pcolor[i]) +
+					svarint_len(x0 - enc->px0[i]) + svarint_len(y0 - enc->py0[i]) +
+					svarint_len(x1 - enc->px1[i]) + svarint_len(y1 - enc->py1[i]);
+			}
+		}
+
+		if (frame_len < 0)
+		{
+			*p++ = VSTREAM_COPY;
+		}
+		else if (frame_len < vertex_len)
+		{
+			tag = VSTREAM_FRAME;
+			if (color == enc->pcolor[i])
+				tag |= VSTREAM_SAME_COLOR;
+
+			*p++ = tag;
+			if (!(tag & VSTREAM_SAME_COLOR))
+				*p++ = color;
+			p = put_svarint(p, x0 - enc->px0[i]);
+			p = put_svarint(p, y0 - enc->py0[i]);
+			p = put_svarint(p, x1 - enc->px1[i]);
+			p = put_svarint(p, y1 - enc->py1[i]);
+		}
+		else
+		{
+			tag = VSTREAM_VERTEX;
+			if (color == ecolor)
+				tag |= VSTREAM_SAME_COLOR;
+			if (joined)
+				tag |= VSTREAM_JOINED;
+
+			*p++ = tag;
+			if (!(tag & VSTREAM_SAME_COLOR))
+				*p++ = color;
+			if (!joined)
+			{
+				p = put_svarint(p, x0 - ex);
+				p = put_svarint(p, y0 - ey);
+			}
+			p = put_svarint(p, x1 - x0);
+			p = put_svarint(p, y1 - y0);
+		}
+
+		ex = x1;
+		ey = y1;
+		ecolor = color;
+	}
+
+	if (key)
+	{
+		if (enc->key_cnt == enc->key_max)
+		{
+			uint32_t max = enc->key_max ? enc->key_max * 2 : 256;
+			uint32_t *kf = realloc(enc->key_frame, max * sizeof(uint32_t));
+			uint64_t *ko;
+
+			if (kf)
+				enc->key_frame = kf;
+			ko = realloc(enc->key_offset, max * sizeof(uint64_t));
+			if (ko)
+				enc->key_offset = ko;
+			if (kf && ko)
+				enc->key_max = max;
+		}
+
+		/* without memory for the index the keyframe is still written,
+		 * it just can not be seeked to.
+		 */
+		if (enc->key_cnt < enc->key_max)
+		{
+			enc->key_frame[enc->key_cnt] = frame->frame;
+			enc->key_offset[enc->key_cnt] = enc->offset;
+			enc->key_cnt++;
+		}
+	}
+
+	*h++ = key ? VSTREAM_KEYFRAME : VSTREAM_DELTAFRAME;
+	h = put_varint(h, frame->frame - enc->frame);
+	h = put_varint(h, (uint32_t)(p - enc->body));
+
+	fwrite(head, 1, h - head, enc->file);
+	fwrite(enc->body, 1, p - enc->body, enc->file);
+	enc->offset += (uint64_t)(h - head) + (uint64_t)(p - enc->body);
+
+	memcpy(enc->px0, frame->x0, frame->cnt * sizeof(uint16_t));
+	memcpy(enc->py0, frame->y0, frame->cnt * sizeof(uint16_t));
+	memcpy(enc->px1, frame->x1, frame->cnt * sizeof(uint16_t));
+	memcpy(enc->py1, frame->y1, frame->cnt * sizeof(uint16_t));
+	memcpy(enc->pcolor, frame->color, frame->cnt);
+	enc->prev_cnt = frame->cnt;
+
+	enc->frame = frame->frame + 1;
+}
+
+void vstream_enc_close(vstream_enc *enc)
+{
+	if (enc->file)
+	{
+		uint64_t index = enc->offset;
+
+		for (uint32_t k = 0; k < enc->key_cnt; k++)
+		{
+			write_le(enc->file, enc->key_frame[k], 4);
+			write_le(enc->file, enc->key_offset[k], 8);
+		}
+
+		write_le(enc->file, enc->key_cnt, 4);
+		write_le(enc->file, index, 8);
+		fwrite(trailer_magic, 1, sizeof(trailer_magic), enc->file);
+
+		fclose(enc->file);
+	}
+
+	enc_free(enc);
+}
+
+static int writer(void *data)
+{
+	vstream_rec *rec = (vstream_rec *)data;
+
+	for (;;)
+	{
+		vstream_frame *frame;
+
+		SDL_SemWait(rec->full);
+		frame = &rec->queue[rec->tail];
+
+		if (frame->cnt == VSTREAM_END)
+			break;
+
+		vstream_enc_frame(&rec->enc, frame);
+
+		rec->tail = (rec->tail + 1) % VSTREAM_QUEUE;
+		SDL_SemPost(rec->free);
+	}
+
+	return 0;
+}
+
+static void rec_free(vstream_rec *rec)
+{
+	for (int i = 0; i < VSTREAM_QUEUE; i++)
+	{
+		free(rec->queue[i].x0);
+		free(rec->queue[i].y0);
+		free(rec->queue[i].x1);
+		free(rec->queue[i].y1);
+		free(rec->queue[i].color);
+	}
+
+	if (rec->free)
+		SDL_DestroySemaphore(rec->free);
+	if (rec->full)
+		SDL_DestroySemaphore(rec->full);
+
+	memset(rec, 0, sizeof(*rec));
+}
+
+int vstream_rec_open(vstream_rec *rec, const char *name)
+{
+	memset(rec, 0, sizeof(*rec));
+
+	for (int i = 0; i < VSTREAM_QUEUE; i++)
+	{
+		vstream_frame *frame = &rec->queue[i];
+
+		frame->x0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		frame->y0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		frame->x1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		frame->y1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		frame->color = malloc(VLIST_MAX_CNT);
+
+		if (!frame->x0 || !frame->y0 || !frame->x1 || !frame->y1 || !frame->color)
+		{
+			rec_free(rec);
+			return 0;
+		}
+	}
+
+	rec->free = SDL_CreateSemaphore(VSTREAM_QUEUE);
+	rec->full = SDL_CreateSemaphore(0);
+
+	if (!rec->free || !rec->full || !vstream_enc_open(&rec->enc, name))
+	{
+		rec_free(rec);
+		return 0;
+	}
+
+	rec->thread = SDL_CreateThread(writer, "vstream", rec);
+	if (!rec->thread)
+	{
+		fprintf(stderr, "Failed to create recording thread: %s\n", SDL_GetError());
+		vstream_enc_close(&rec->enc);
+		rec_free(rec);
+		return 0;
+	}
+
+	return 1;
+}
+
+void vstream_rec_frame(vstream_rec *rec, const vlist *list)
+{
+	vstream_frame *frame;
+	uint32_t cnt = (uint32_t)list->cnt;
+
+	if (!rec->thread)
+		return;
+
+	if (SDL_SemTryWait(rec->free) != 0)
+	{
+		rec->dropped++;
+		rec->frame++;
+		return;
+	}
+
+	frame = &rec->queue[rec->head];
+	frame->frame = rec->frame++;
+	frame->cnt = cnt;
+	memcpy(frame->x0, list->x0, cnt * sizeof(uint16_t));
+	memcpy(frame->y0, list->y0, cnt * sizeof(uint16_t));
+	memcpy(frame->x1, list->x1, cnt * sizeof(uint16_t));
+	memcpy(frame->y1, list->y1, cnt * sizeof(uint16_t));
+	memcpy(frame->color, list->color, cnt);
+
+	rec->head = (rec->head + 1) % VSTREAM_QUEUE;
+	SDL_SemPost(rec->full);
+}
+
+void vstream_rec_close(vstream_rec *rec)
+{
+	if (!rec->thread)
+		return;
+
+	SDL_SemWait(rec->free);
+	rec->queue[rec->head].cnt = VSTREAM_END;
+	SDL_SemPost(rec->full);
+	SDL_WaitThread(rec->thread, NULL);
+
+	if (rec->dropped)
+		fprintf(stderr, "Recording dropped %u frames\n", rec->dropped);
+
+	vstream_enc_close(&rec->enc);
+	rec_free(rec);
+}
+
+static uint64_t read_le(const uint8_t *p, int bytes)
+{
+	uint64_t v = 0;
+	for (int i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+/* varint readers, these stop at end and leave *p there on overrun */
+static uint32_t get_varint(const uint8_t **p, const uint8_t *end)
+{
+	uint32_t v = 0;
+	int shift = 0;
+
+	while (*p < end && shift < 35)
+	{
+		uint8_t b = *(*p)++;
+		v |= (uint32_t)(b & 0x7f) << shift;
+		if (b < 0x80)
+			break;
+		shift += 7;
+	}
+
+	return v;
+}
+
+static int32_t get_svarint(const uint8_t **p, const uint8_t *end)
+{
+	uint32_t z = get_varint(p, end);
+	return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static int map_file(vstream_reader *rd, const char *name)
+{
+#ifdef _WIN32
+	HANDLE file, map;
+	LARGE_INTEGER size;
+
+	file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+
+	map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!map)
+		return 0;
+
+	rd->data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	if (!rd->data)
+	{
+		CloseHandle(map);
+		return 0;
+	}
+
+	rd->size = (size_t)size.QuadPart;
+	rd->map = map;
+	return 1;
+#else
+	struct stat st;
+	void *data;
+	int fd = open(name, O_RDONLY);
+
+	if (fd < 0)
+		return 0;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return 0;
+
+	rd->data = data;
+	rd->size = (size_t)st.st_size;
+	rd->map = data;
+	return 1;
+#endif
+}
+
+static void unmap_file(vstream_reader *rd)
+{
+	if (!rd->map)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(rd->data);
+	CloseHandle((HANDLE)rd->map);
+#else
+	munmap(rd->map, rd->size);
+#endif
+}
+
+int vstream_read_open(vstream_reader *rd, const char *name)
+{
+	memset(rd, 0, sizeof(*rd));
+
+	if (!map_file(rd, name))
+	{
+		perror(name);
+		return 0;
+	}
+
+	rd->px0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	rd->py0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	rd->px1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	rd->py1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+	rd->pcolor = malloc(VLIST_MAX_CNT);
+
+	if (!rd->px0 || !rd->py0 || !rd->px1 || !rd->py1 || !rd->pcolor)
+	{
+		vstream_read_close(rd);
+		return 0;
+	}
+
+	if (rd->size >= VSTREAM_HEADER_SIZE + VSTREAM_TRAILER_SIZE &&
+		memcmp(rd->data, header_magic, sizeof(header_magic)) == 0 &&
+		memcmp(rd->data + rd->size - sizeof(trailer_magic), trailer_magic, sizeof(trailer_magic)) == 0)
+	{
+		const uint8_t *trailer = rd->data + rd->size - VSTREAM_TRAILER_SIZE;
+		uint64_t index = read_le(trailer + 4, 8);
+
+		if (read_le(rd->data + 8, 2) != VSTREAM_VERSION)
+		{
+			fprintf(stderr, "%s: unsupported vecstream version\n", name);
+			vstream_read_close(rd);
+			return 0;
+		}
+
+		rd->key_cnt = (uint32_t)read_le(trailer, 4);
+		if (index > rd->size - VSTREAM_TRAILER_SIZE ||
+			(uint64_t)rd->key_cnt * VSTREAM_INDEX_ENTRY != rd->size - VSTREAM_TRAILER_SIZE - index)
+		{
+			fprintf(stderr, "%s: damaged vecstream index\n", name);
+			vstream_read_close(rd);
+			return 0;
+		}
+
+		rd->index = rd->data + index;
+		rd->pos = VSTREAM_HEADER_SIZE;
+	}
+	else if (memcmp(rd->data, header_magic, sizeof(header_magic)) == 0)
+	{
+		fprintf(stderr, "%s: vecstream was not closed properly\n", name);
+		vstream_read_close(rd);
+		return 0;
+	}
+	else
+	{
+		rd->raw = 1;
+		rd->pos = 0;
+	}
+
+	return 1;
+}
+
+void vstream_read_close(vstream_reader *rd)
+{
+	unmap_file(rd);
+	free(rd->px0);
+	free(rd->py0);
+	free(rd->px1);
+	free(rd->py1);
+	free(rd->pcolor);
+	memset(rd, 0, sizeof(*rd));
+}
+
+/* end of the frame records */
+static const uint8_t *records_end(const vstream_reader *rd)
+{
+	return rd->raw ? rd->data + rd->size : rd->index;
+}
+
+static int read_raw(vstream_reader *rd)
+{
+	const uint8_t *p = rd->data + rd->pos;
+	const uint8_t *end = records_end(rd);
+	uint32_t cnt;
+
+	if (end - p < 4)
+		return 0;
+
+	cnt = (uint32_t)read_le(p, 4);
+	p += 4;
+
+	if (cnt > VLIST_MAX_CNT || (size_t)(end - p) < (size_t)cnt * VSTREAM_RAW_VECTOR)
+		return 0;
+
+	for (uint32_t i = 0; i < cnt; i++)
+	{
+		rd->px0[i] = (uint16_t)read_le(p + 2 * i, 2);
+		rd->py0[i] = (uint16_t)read_le(p + 2 * (cnt + i), 2);
+		rd->px1[i] = (uint16_t)read_le(p + 2 * (2 * cnt + i), 2);
+		rd->py1[i] = (uint16_t)read_le(p + 2 * (3 * cnt + i), 2);
+	}
+	memcpy(rd->pcolor, p + 8 * cnt, cnt);
+
+	rd->prev_cnt = cnt;
+	rd->pos = (size_t)(p - rd->data) + (size_t)cnt * VSTREAM_RAW_VECTOR;
+	rd->frame++;
+	return 1;
+}
+
+/* decode the next record into the reference frame */
+static int read_record(vstream_reader *rd)
+{
+	const uint8_t *p = rd->data + rd->pos;
+	const uint8_t *end = records_end(rd);
+	const uint8_t *body_end;
+	uint32_t gap, size, cnt;
+	int key;
+	int32_t ex = 0, ey = 0;
+	uint8_t ecolor = 0;
+
+	if (rd->raw)
+		return read_raw(rd);
+
+	if (p >= end)
+		return 0;
+
+	key = *p++ == VSTREAM_KEYFRAME;
+	gap = get_varint(&p, end);
+	size = get_varint(&p, end);
+
+	if ((size_t)(end - p) < size)
+		return 0;
+
+	body_end = p + size;
+	cnt = get_varint(&p, body_end);
+
+	if (cnt > VLIST_MAX_CNT)
+		return 0;
+
+	for (uint32_t i = 0; i < cnt; i++)
+	{
+		uint8_t tag;
+		int mode;
+
+		if (p >= body_end)
+			return 0;
+
+		tag = *p++;
+		mode = tag & VSTREAM_MODE;
+
+		if (mode == VSTREAM_MODE || (mode != VSTREAM_VERTEX && (key || i >= rd->prev_cnt)))
+			return 0;
+
+		if (mode != VSTREAM_COPY && !(tag & VSTREAM_SAME_COLOR) && p >= body_end)
+			return 0;
+
+		if (mode == VSTREAM_FRAME)
+		{
+			if (!(tag & VSTREAM_SAME_COLOR))
+				rd->pcolor[i] = *p++;
+			rd->px0[i] = (uint16_t)(rd->px0[i] + get_svarint(&p, body_end));
+			rd->py0[i] = (uint16_t)(rd->py0[i] + get_svarint(&p, body_end));
+			rd->px1[i] = (uint16_t)(rd->px1[i] + get_svarint(&p, body_end));
+			rd->py1[i] = (uint16_t)(rd->py1[i] + get_svarint(&p, body_end));
+		}
+		else if (mode == VSTREAM_VERTEX)
+		{
+			int32_t x0 = ex, y0 = ey;
+
+			rd->pcolor[i] = (tag & VSTREAM_SAME_COLOR) ? ecolor : *p++;
+			if (!(tag & VSTREAM_JOINED))
+			{
+				x0 += get_svarint(&p, body_end);
+				y0 += get_svarint(&p, body_end);
+			}
+			rd->px0[i] = (uint16_t)x0;
+			rd->py0[i] = (uint16_t)y0;
+			rd->px1[i] = (uint16_t)(x0 + get_svarint(&p, body_end));
+			rd->py1[i] = (uint16_t)(y0 + get_svarint(&p, body_end));
+		}
+
+		/* VSTREAM_COPY keeps vector i as it is */
+
+		ex = rd->px1[i];
+		ey = rd->py1[i];
+		ecolor = rd->pcolor[i];
+	}
+
+	if (p != body_end)
+		return 0;
+
+	rd->prev_cnt = cnt;
+	rd->pos = (size_t)(body_end - rd->data);
+	rd->frame += gap + 1;
+	return 1;
+}
+
+int vstream_read_frame(vstream_reader *rd, vlist *list)
+{
+	if (!read_record(rd))
+		return 0;
+
+	vlist_clear(list);
+	for (uint32_t i = 0; i < rd->prev_cnt; i++)
+		vlist_add(list, rd->px0[i], rd->py0[i], rd->px1[i], rd->py1[i], rd->pcolor[i], 0);
+
+	return 1;
+}
+
+/* number the next record will get, or 0xffffffff at the end */
+static uint32_t next_number(const vstream_reader *rd)
+{
+	const uint8_t *p = rd->data + rd->pos;
+	const uint8_t *end = records_end(rd);
+
+	if (p >= end)
+		return 0xffffffffu;
+
+	if (rd->raw)
+		return rd->frame;
+
+	p++;
+	return rd->frame + get_varint(&p, end);
+}
+
+void vstream_read_seek(vstream_reader *rd, uint32_t frame)
+{
+	rd->pos = rd->raw ? 0 : VSTREAM_HEADER_SIZE;
+	rd->frame = 0;
+	rd->prev_cnt = 0;
+
+	if (rd->raw)
+	{
+		/* no index, but skipping a raw frame only needs its count */
+		while (rd->frame < frame && rd->pos + 4 <= rd->size)
+		{
+			uint32_t cnt = (uint32_t)read_le(rd->data + rd->pos, 4);
+			if (cnt > VLIST_MAX_CNT || rd->size - rd->pos - 4 < (size_t)cnt * VSTREAM_RAW_VECTOR)
+				break;
+			rd->pos += 4 + (size_t)cnt * VSTREAM_RAW_VECTOR;
+			rd->frame++;
+		}
+		return;
+	}
+
+	/* start at the last keyframe at or before the wanted frame */
+	{
+		uint32_t lo = 0, hi = rd->key_cnt;
+
+		while (lo < hi)
+		{
+			uint32_t mid = (lo + hi) / 2;
+			if ((uint32_t)read_le(rd->index + mid * VSTREAM_INDEX_ENTRY, 4) <= frame)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if (lo > 0)
+		{
+			const uint8_t *entry = rd->index + (lo - 1) * VSTREAM_INDEX_ENTRY;
+			const uint8_t *p;
+			uint32_t number = (uint32_t)read_le(entry, 4);
+
+			rd->pos = (size_t)read_le(entry + 4, 8);
+
+			/* the record stores its gap to the previous frame, work back
+			 * from the indexed number to what read_record expects.
+			 */
+			p = rd->data + rd->pos + 1;
+			rd->frame = number - get_varint(&p, records_end(rd));
+		}
+	}
+
+	while (next_number(rd) < frame)
+	{
+		if (!read_record(rd))
+			break;
+	}
+}
@@ -0,0 +1,151 @@
+#ifndef __VSTREAM_H
+#define __VSTREAM_H
+
+#include <stdio.h>
+#include <SDL.h>
+
+#include "emu\vlist.h"
+
+/* vecstream files hold the vector lists of consecutive frames. all integers
+ * are little endian.
+ *
+ *   header   "VECSTRM" 0x00, u16 version, u16 keyframe interval
+ *   frames   u8 type, varint frames skipped before this one, varint body
+ *            size, body
+ *   index    per keyframe: u32 frame number, u64 file offset of the record
+ *   trailer  u32 keyframe count, u64 index offset, "VSINDEX" 0x00
+ *
+ * a frame body is a varint vector count followed by the vectors, each
+ * starting with a tag byte:
+ *
+ *   bits 0-1  VSTREAM_COPY    same as vector i of the previous frame
+ *             VSTREAM_VERTEX  x0, y0 relative to the end of the previous
+ *                             vector, x1, y1 relative to x0, y0
+ *             VSTREAM_FRAME   each coordinate relative to vector i of the
+ *                             previous frame
+ *   bit 2     VSTREAM_SAME_COLOR, otherwise a color byte follows the tag
+ *   bit 3     VSTREAM_JOINED, vertex mode vector starting where the previous
+ *             one ended, x0 and y0 are left out
+ *
+ * coordinates follow as zigzag varints. keyframes only use VSTREAM_VERTEX so
+ * decoding can start at any of them.
+ *
+ * the reader also accepts raw dumps of the vector list, a frame after the
+ * other laid out like the vlist arrays: u32 count, then count each of u16
+ * x0, y0, x1, y1 and u8 color.
+ */
+
+enum
+{
+	VSTREAM_VERSION = 1,
+	VSTREAM_KEY_INTERVAL = 30, /* a keyframe every second */
+
+	VSTREAM_KEYFRAME = 1,
+	VSTREAM_DELTAFRAME = 2,
+
+	VSTREAM_COPY = 0,
+	VSTREAM_VERTEX = 1,
+	VSTREAM_FRAME = 2,
+	VSTREAM_MODE = 0x03,
+	VSTREAM_SAME_COLOR = 0x04,
+	VSTREAM_JOINED = 0x08,
+
+	/* frames queued for the writer thread */
+	VSTREAM_QUEUE = 8
+};
+
+/* a frame waiting to be encoded */
+typedef struct
+{
+	uint32_t frame;
+	uint32_t cnt;
+	uint16_t *x0, *y0, *x1, *y1;
+	uint8_t *color;
+} vstream_frame;
+
+/* frame encoder state, shared by the recorder and tools writing streams */
+typedef struct
+{
+	uint32_t frame;   /* number the next frame gets unless some are skipped */
+
+	/* the previous frame, the reference for delta frames */
+	uint32_t prev_cnt;
+	uint16_t *px0, *py0, *px1, *py1;
+	uint8_t *pcolor;
+
+	uint8_t *body;
+
+	uint32_t key_cnt;
+	uint32_t key_max;
+	uint32_t *key_frame;
+	uint64_t *key_offset;
+
+	FILE *file;
+	uint64_t offset;
+} vstream_enc;
+
+/* records frames to a file, encoding and writing on a background thread */
+typedef struct
+{
+	vstream_enc enc;
+
+	vstream_frame queue[VSTREAM_QUEUE];
+	int head;         /* next slot to fill, producer only */
+	int tail;         /* next slot to encode, writer only */
+	SDL_sem *free;
+	SDL_sem *full;
+	SDL_Thread *thread;
+
+	uint32_t frame;   /* frames offered so far, producer only */
+	uint32_t dropped; /* frames lost to a full queue, producer only */
+} vstream_rec;
+
+/* reads frames back from a memory mapped vecstream or raw dump */
+typedef struct
+{
+	const uint8_t *data;
+	size_t size;
+	int raw;
+
+	size_t pos;      /* offset of the next record */
+	uint32_t frame;  /* number of the next frame */
+
+	uint32_t key_cnt;
+	const uint8_t *index;
+
+	/* the last decoded frame, the reference for delta frames */
+	uint32_t prev_cnt;
+	uint16_t *px0, *py0, *px1, *py1;
+	uint8_t *pcolor;
+
+	void *map; /* platform mapping handle */
+} vstream_reader;
+
+int vstream_enc_open(vstream_enc *enc, const char *name);
+void vstream_enc_frame(vstream_enc *enc, const vstream_frame *frame);
+void vstream_enc_close(vstream_enc *enc);
+
+int vstream_rec_open(vstream_rec *rec, const char *name);
+
+/* queue a frame for recording. never blocks, if the writer has fallen
+ * behind the frame is dropped.
+ */
+void vstream_rec_frame(vstream_rec *rec, const vlist *list);
+
+/* write out everything still queued and close the file */
+void vstream_rec_close(vstream_rec *rec);
+
+int vstream_read_open(vstream_reader *rd, const char *name);
+void vstream_read_close(vstream_reader *rd);
+
+/* decode the next frame into list. returns 0 at the end of the stream or
+ * on a damaged record. rd->frame - 1 is the number of the frame read.
+ */
+int vstream_read_frame(vstream_reader *rd, vlist *list);
+
+/* position the reader so the next frame read is the given one, or the
+ * first one after it if it was not recorded.
+ */
+void vstream_read_seek(vstream_reader *rd, uint32_t frame);
+
+#endif
@@ -0,0 +1,66 @@
+#include <stdint.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "vtarget.h"
+
+void vtarget_init(vtarget *t, uint32_t format, int access)
+{
+	memset(t, 0, sizeof(*t));
+
+	t->format = format;
+	t->access = access;
+}
+
+void vtarget_done(vtarget *t)
+{
+	if (t->tex)
+		SDL_DestroyTexture(t->tex);
+
+	vtarget_init(t, t->format, t->access);
+}
+
+static int size_class(int n)
+{
+	int c = VTARGET_MIN_SIZE;
+
+	while (c < n)
+		c *= 2;
+
+	return c;
+}
+
+int vtarget_size(vtarget *t, SDL_Renderer *renderer, int w, int h)
+{
+	int cw = size_class(w), ch = size_class(h);
+	int created = 0;
+
+	/* shrink only past two classes, so going back and forth across a power
+	 * of two does not allocate every time
+	 */
+	if (!t->tex || cw > t->cls_w || ch > t->cls_h || t->cls_w > 2 * cw || t->cls_h > 2 * ch)
+	{
+		if (t->tex)
+			SDL_DestroyTexture(t->tex);
+
+		t->tex = SDL_CreateTexture(renderer, t->format, t->access, cw, ch);
+		if (!t->tex)
+		{
+			t->cls_w = t->cls_h = 0;
+			return -1;
+		}
+
+		t->cls_w = cw;
+		t->cls_h = ch;
+		created = 1;
+	}
+
+	t->w = w;
+	t->h = h;
+	t->rect.x = 0;
+	t->rect.y = 0;
+	t->rect.w = w;
+	t->rect.h = h;
+
+	return created;
+}
@@ -0,0 +1,37 @@
+#ifndef __VTARGET_H
+#define __VTARGET_H
+
+#include <stdint.h>
+#include <SDL.h>
+
+enum
+{
+	VTARGET_MIN_SIZE = 64 /* smallest size class */
+};
+
+/* a texture used at a size that follows the window. it is allocated at the
+ * next power of two up in each direction and only the top left w * h part
+ * is used, so a window being dragged to a new size keeps the texture until
+ * it outgrows it or gets to a quarter of it in a direction.
+ */
+typedef struct
+{
+	SDL_Texture *tex;
+	uint32_t format;
+	int access;
+
+	int cls_w, cls_h; /* allocated size */
+	int w, h;         /* size in use */
+	SDL_Rect rect;    /* 0, 0, w, h */
+} vtarget;
+
+void vtarget_init(vtarget *t, uint32_t format, int access);
+void vtarget_done(vtarget *t);
+
+/* use w * h of the texture. returns 1 if it had to be allocated, its
+ * contents and settings are new then, 0 if the old one was kept and -1 if
+ * allocating failed.
+ */
+int vtarget_size(vtarget *t, SDL_Renderer *renderer, int w, int h);
+
+#endif
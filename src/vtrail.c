@@ -0,0 +1,199 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vtrail.h"
+#include "emu\vecx.h"
+#include "emu\vlist.h"
+
+int vtrail_init(vtrail *trail)
+{
+	memset(trail, 0, sizeof(*trail));
+
+	trail->config.frames = 4;
+	trail->config.tau = 1.0f / (VECTREX_PDECAY * 0.693147f);
+	trail->config.min_color = 1;
+
+	for (int i = 0; i < VTRAIL_MAX_FRAMES; i++)
+	{
+		vtrail_frame *f = &trail->ring[i];
+
+		f->x0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		f->y0 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		f->x1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		f->y1 = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+		f->color = malloc(VLIST_MAX_CNT);
+		f->t = malloc(VLIST_MAX_CNT * sizeof(uint16_t));
+
+		if (!f->x0 || !f->y0 || !f->x1 || !f->y1 || !f->color || !f->t)
+		{
+			vtrail_done(trail);
+			return 0;
+		}
+	}
+
+	trail->out = malloc(sizeof(vlist));
+
+	if (!trail->out)
+	{
+		vtrail_done(trail);
+		return 0;
+	}
+
+	vlist_clear(trail->out);
+	return 1;
+}
+
+void vtrail_done(vtrail *trail)
+{
+	for (int i = 0; i < VTRAIL_MAX_FRAMES; i++)
+	{
+		vtrail_frame *f = &trail->ring[i];
+
+		free(f->x0);
+		free(f->y0);
+		free(f->x1);
+		free(f->y1);
+		free(f->color);
+		free(f->t);
+	}
+
+	free(trail->out);
+	memset(trail, 0, sizeof(*trail));
+}
+
+static void make_fade(vtrail *trail)
+{
+	float tau = trail->config.tau > 1e-4f ? trail->config.tau : 1e-4f;
+	float step = (float)(1 << VTRAIL_AGE_SHIFT) / (tau * VECTREX_MHZ);
+
+	for (int i = 0; i < VTRAIL_AGES; i++)
+		trail->fade[i] = (uint16_t)(65535.0f * expf(-i * step) + 0.5f);
+
+	trail->lut_tau = trail->config.tau;
+}
+
+/* intensity of a color drawn age cycles ago */
+static uint32_t faded(const vtrail *trail, uint8_t color, uint32_t age)
+{
+	uint32_t i = age >> VTRAIL_AGE_SHIFT;
+
+	if (i >= VTRAIL_AGES)
+		return 0;
+
+	return ((uint32_t)color * trail->fade[i] + 32768) >> 16;
+}
+
+static void keep(vtrail *trail, const vlist *in, uint32_t start, uint32_t end, int timed)
+{
+	vtrail_frame *f;
+	uint32_t cnt = (uint32_t)in->cnt;
+
+	trail->head = (trail->head + 1) % VTRAIL_MAX_FRAMES;
+	f = &trail->ring[trail->head];
+
+	f->cnt = cnt;
+	f->start = start;
+	f->end = end;
+	memcpy(f->x0, in->x0, cnt * sizeof(uint16_t));
+	memcpy(f->y0, in->y0, cnt * sizeof(uint16_t));
+	memcpy(f->x1, in->x1, cnt * sizeof(uint16_t));
+	memcpy(f->y1, in->y1, cnt * sizeof(uint16_t));
+	memcpy(f->color, in->color, cnt);
+
+	if (timed)
+		memcpy(f->t, in->t, cnt * sizeof(uint16_t));
+	else
+		memset(f->t, 0, cnt * sizeof(uint16_t));
+}
+
+const vlist *vtrail_run(vtrail *trail, const vlist *in)
+{
+	vlist *out = trail->out;
+	uint32_t frames = trail->config.frames;
+	uint32_t min_color = trail->config.min_color > 0 ? trail->config.min_color : 1;
+	uint32_t budget[VTRAIL_MAX_FRAMES];
+	uint32_t room = VLIST_MAX_CNT;
+	uint32_t now;
+
+	if (frames < 1)
+		frames = 1;
+	if (frames > VTRAIL_MAX_FRAMES)
+		frames = VTRAIL_MAX_FRAMES;
+
+	if (trail->lut_tau != trail->config.tau)
+		make_fade(trail);
+
+	/* lists without timing count as drawn at the end of a frame of the
+	 * usual length
+	 */
+	if (in->cycles > 0)
+	{
+		now = in->start + in->cycles;
+		keep(trail, in, in->start, now, 1);
+	}
+	else
+	{
+		trail->clock += FCYCLES_INIT;
+		now = trail->clock;
+		keep(trail, in, now, now, 0);
+	}
+
+	trail->kept = trail->kept < frames ? trail->kept + 1 : frames;
+
+	memset(&trail->stats, 0, sizeof(trail->stats));
+	trail->stats.in = (uint32_t)in->cnt;
+
+	vlist_clear(out);
+	out->start = in->start;
+	out->cycles = in->cycles;
+
+	/* the frames are drawn oldest first but the list is filled newest
+	 * first, an older frame only gets the room the newer ones leave. a
+	 * full list loses the oldest vectors, never the current frame, and a
+	 * frame that only partly fits loses its earliest vectors.
+	 */
+	for (uint32_t k = 0; k < trail->kept; k++)
+	{
+		uint32_t cnt = trail->ring[(trail->head + VTRAIL_MAX_FRAMES - k) % VTRAIL_MAX_FRAMES].cnt;
+
+		budget[k] = cnt < room ? cnt : room;
+		room -= budget[k];
+	}
+
+	/* oldest first so the current frame ends up on top */
+	for (uint32_t k = trail->kept; k-- > 0;)
+	{
+		const vtrail_frame *f = &trail->ring[(trail->head + VTRAIL_MAX_FRAMES - k) % VTRAIL_MAX_FRAMES];
+
+		/* even the brightest vector at the end of the frame is gone */
+		if (k > 0 && faded(trail, VECTREX_COLORS - 1, now - f->end) < min_color)
+		{
+			trail->stats.faded += f->cnt;
+			continue;
+		}
+
+		trail->stats.crowded += f->cnt - budget[k];
+
+		for (uint32_t i = f->cnt - budget[k]; i < f->cnt; i++)
+		{
+			uint32_t c = faded(trail, f->color[i], now - (f->start + f->t[i]));
+
+			if (c < min_color)
+			{
+				trail->stats.faded++;
+				continue;
+			}
+
+			/* older frames keep no time inside the current one */
+			vlist_add(out, f->x0[i], f->y0[i], f->x1[i], f->y1[i], (uint8_t)c, k == 0 ? f->t[i] : 0);
+
+			if (k > 0)
+				trail->stats.aged++;
+		}
+	}
+
+	trail->stats.out = (uint32_t)out->cnt;
+	return out;
+}
@@ -0,0 +1,79 @@
+#ifndef __VTRAIL_H
+#define __VTRAIL_H
+
+#include "emu\vlist.h"
+
+enum
+{
+	VTRAIL_MAX_FRAMES = 8,  /* frames kept, the current one included */
+
+	/* fade table, one entry per 2^VTRAIL_AGE_SHIFT cycles of age. it
+	 * reaches past VTRAIL_MAX_FRAMES frames, older vectors are gone.
+	 */
+	VTRAIL_AGE_SHIFT = 9,
+	VTRAIL_AGES = 1024
+};
+
+typedef struct
+{
+	uint32_t frames;    /* frames kept, 1 draws the current one only */
+	float tau;          /* phosphor time constant in seconds */
+	uint8_t min_color;  /* vectors fading below this are dropped */
+} vtrail_config;
+
+/* what happened to the last frame */
+typedef struct
+{
+	uint32_t in;
+	uint32_t aged;      /* vectors of older frames drawn again */
+	uint32_t faded;     /* dropped for fading below min_color */
+	uint32_t crowded;   /* older vectors left out of a full list */
+	uint32_t out;
+} vtrail_stats;
+
+/* a kept frame */
+typedef struct
+{
+	uint32_t cnt;
+	uint32_t start;     /* cycles, t of the vectors counts from here */
+	uint32_t end;       /* cycles at the end of the frame */
+	uint16_t *x0, *y0, *x1, *y1;
+	uint8_t *color;
+	uint16_t *t;
+} vtrail_frame;
+
+/* phosphor persistence in vector space. the last few frames are kept and
+ * drawn again each frame, every vector with its intensity faded by the
+ * time since the beam drew it, exp(-age / tau). vectors faded below
+ * min_color are dropped and a frame goes once all of it has.
+ *
+ * the output is a plain vector list, a renderer draws it over a cleared
+ * target instead of fading the old picture. a sparse scene costs a few
+ * hundred more vectors rather than a pass over every pixel, and the result
+ * needs no framebuffer at all, vector outputs get the afterglow as well.
+ */
+typedef struct
+{
+	vtrail_config config;
+	vtrail_stats stats;
+
+	vtrail_frame ring[VTRAIL_MAX_FRAMES];
+	uint32_t head;      /* slot of the newest frame */
+	uint32_t kept;      /* frames in the ring */
+	uint32_t clock;     /* end of the newest frame for untimed lists */
+
+	float lut_tau;      /* tau the table was made for */
+	uint16_t fade[VTRAIL_AGES]; /* 65535 is full intensity */
+
+	vlist *out;
+} vtrail;
+
+int vtrail_init(vtrail *trail);
+void vtrail_done(vtrail *trail);
+
+/* add a frame and return it with the kept ones faded under it. the result
+ * stays valid until the next call.
+ */
+const vlist *vtrail_run(vtrail *trail, const vlist *in);
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "vview.h"
+#include "emu\edac.h"
+#include "emu\vlist.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VVIEW_X86
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_SSE2
+#endif
+
+int vview_init(vview *view)
+{
+	memset(view, 0, sizeof(*view));
+
+#ifdef VVIEW_X86
+	view->simd = SDL_HasSSE2();
+#endif
+
+	view->out = malloc(sizeof(vlist));
+
+	if (!view->out)
+		return 0;
+
+	vlist_clear(view->out);
+	vview_resize(view, DAC_MAX_X, DAC_MAX_Y);
+	return 1;
+}
+
+void vview_done(vview *view)
+{
+	free(view->out);
+	memset(view, 0, sizeof(*view));
+}
+
+void vview_resize(vview *view, int width, int height)
+{
+	int rotate = view->config.rotate & 3;
+	int turned = rotate & 1;
+	float pw = (float)(turned ? DAC_MAX_Y : DAC_MAX_X);
+	float ph = (float)(turned ? DAC_MAX_X : DAC_MAX_Y);
+	float sx = width / pw, sy = height / ph;
+	float s = sx < sy ? sx : sy;
+	float ox, oy;
+	vview_xform *m = &view->xform;
+
+	view->width = width;
+	view->height = height;
+	view->scale = s;
+	view->quant = s > 0.0f && s < 1.0f ? (int32_t)(1.0f / s) : 1;
+
+	view->w = (int)(pw * s);
+	view->h = (int)(ph * s);
+	view->x = (width - view->w) / 2;
+	view->y = (height - view->h) / 2;
+
+	ox = (float)view->x;
+	oy = (float)view->y;
+
+	/* the far edge maps to the last dac unit so it stays inside */
+	switch (rotate)
+	{
+	case 0:
+		m->ax = s;  m->bx = 0;  m->cx = ox;
+		m->ay = 0;  m->by = s;  m->cy = oy;
+		break;
+	case 1:
+		m->ax = 0;  m->bx = -s; m->cx = ox + s * (DAC_MAX_Y - 1);
+		m->ay = s;  m->by = 0;  m->cy = oy;
+		break;
+	case 2:
+		m->ax = -s; m->bx = 0;  m->cx = ox + s * (DAC_MAX_X - 1);
+		m->ay = 0;  m->by = -s; m->cy = oy + s * (DAC_MAX_Y - 1);
+		break;
+	case 3:
+		m->ax = 0;  m->bx = s;  m->cx = ox;
+		m->ay = -s; m->by = 0;  m->cy = oy + s * (DAC_MAX_X - 1);
+		break;
+	}
+}
+
+static void xform_scalar(const vview_xform *m, const uint16_t *x, const uint16_t *y,
+	uint16_t *ox, uint16_t *oy, size_t i, size_t n)
+{
+	for (; i < n; i++)
+	{
+		float fx = x[i], fy = y[i];
+
+		ox[i] = (uint16_t)(int)(m->ax * fx + m->bx * fy + m->cx);
+		oy[i] = (uint16_t)(int)(m->ay * fx + m->by * fy + m->cy);
+	}
+}
+
+#ifdef VVIEW_X86
+/* eight points a pass, widened to two vectors of four floats each */
+TARGET_SSE2 static size_t xform_sse2(const vview_xform *m, const uint16_t *x, const uint16_t *y,
+	uint16_t *ox, uint16_t *oy, size_t n)
+{
+	__m128 ax = _mm_set1_ps(m->ax), bx = _mm_set1_ps(m->bx), cx = _mm_set1_ps(m->cx);
+	__m128 ay = _mm_set1_ps(m->ay), by = _mm_set1_ps(m->by), cy = _mm_set1_ps(m->cy);
+	__m128i zero = _mm_setzero_si128();
+	size_t i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		__m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+		__m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+		__m128 fx[2], fy[2];
+		__m128i rx[2], ry[2];
+
+		fx[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(vx, zero));
+		fx[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(vx, zero));
+		fy[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(vy, zero));
+		fy[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(vy, zero));
+
+		for (int h = 0; h < 2; h++)
+		{
+			rx[h] = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, fx[h]), _mm_mul_ps(bx, fy[h])), cx));
+			ry[h] = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ay, fx[h]), _mm_mul_ps(by, fy[h])), cy));
+		}
+
+		/* pixels stay below 32768, the signed pack does not clip them */
+		_mm_storeu_si128((__m128i *)(ox + i), _mm_packs_epi32(rx[0], rx[1]));
+		_mm_storeu_si128((__m128i *)(oy + i), _mm_packs_epi32(ry[0], ry[1]));
+	}
+
+	return i;
+}
+#endif
+
+static void xform(const vview *view, const uint16_t *x, const uint16_t *y,
+	uint16_t *ox, uint16_t *oy, size_t n)
+{
+	size_t i = 0;
+
+#ifdef VVIEW_X86
+	if (view->simd)
+		i = xform_sse2(&view->xform, x, y, ox, oy, n);
+#endif
+	xform_scalar(&view->xform, x, y, ox, oy, i, n);
+}
+
+const vlist *vview_run(vview *view, const vlist *in)
+{
+	vlist *out = view->out;
+
+	xform(view, in->x0, in->y0, out->x0, out->y0, in->cnt);
+	xform(view, in->x1, in->y1, out->x1, out->y1, in->cnt);
+	xform(view, in->vx, in->vy, out->vx, out->vy, in->vert_cnt);
+
+	memcpy(out->color, in->color, in->cnt);
+	memcpy(out->vcolor, in->vcolor, in->vert_cnt);
+
+	out->cnt = in->cnt;
+	out->vert_cnt = in->vert_cnt;
+	out->start = in->start;
+	out->cycles = in->cycles;
+	out->traced = 0;
+	return out;
+}
@@ -0,0 +1,54 @@
+#ifndef __VVIEW_H
+#define __VVIEW_H
+
+#include <stdint.h>
+
+#include "emu\vlist.h"
+
+typedef struct
+{
+	int rotate;     /* quarter turns clockwise */
+} vview_config;
+
+/* dac to output pixels, x' = ax x + bx y + cx and y' = ay x + by y + cy */
+typedef struct
+{
+	float ax, bx, cx;
+	float ay, by, cy;
+} vview_xform;
+
+/* where the picture goes in the output. the dac area is scaled to fill as
+ * much of the output as it can at any scale, keeping its aspect, and
+ * centered with black bars on the sides left over.
+ *
+ * the transform is worked out once per resize. renderers that draw whole
+ * pixels get the frame transformed in one pass, renderers that keep sub
+ * pixel precision apply xform themselves.
+ */
+typedef struct
+{
+	vview_config config;
+
+	int width, height;  /* output size */
+	int x, y, w, h;     /* the picture inside the output */
+	float scale;        /* pixels per dac unit */
+	int32_t quant;      /* dac units per pixel, rounded down, at least 1 */
+	vview_xform xform;
+
+	int simd;           /* use the sse2 kernel */
+	vlist *out;
+} vview;
+
+int vview_init(vview *view);
+void vview_done(vview *view);
+
+/* fit the picture to an output of the given size */
+void vview_resize(vview *view, int width, int height);
+
+/* the vectors in whole output pixels, pixel x holding [x, x + 1). only the
+ * coordinates, colors and counts are filled in. the result stays valid
+ * until the next call.
+ */
+const vlist *vview_run(vview *view, const vlist *in);
+
+#endif
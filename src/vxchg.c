@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "vxchg.h"
+#include "emu\vlist.h"
+
+enum
+{
+	VXCHG_INDEX = 0x03,
+	VXCHG_FRESH = 0x04 /* middle buffer holds a frame not yet acquired */
+};
+
+int vxchg_init(vxchg *xchg)
+{
+	memset(xchg, 0, sizeof(*xchg));
+
+	for (int i = 0; i < 3; i++)
+	{
+		xchg->bufs[i] = malloc(sizeof(vlist));
+		if (!xchg->bufs[i])
+		{
+			vxchg_done(xchg);
+			return 0;
+		}
+		vlist_clear(xchg->bufs[i]);
+	}
+
+	xchg->back = 0;
+	xchg->front = 1;
+	SDL_AtomicSet(&xchg->middle, 2);
+
+	return 1;
+}
+
+void vxchg_done(vxchg *xchg)
+{
+	for (int i = 0; i < 3; i++)
+		free(xchg->bufs[i]);
+	memset(xchg, 0, sizeof(*xchg));
+}
+
+vlist *vxchg_back(vxchg *xchg)
+{
+	return xchg->bufs[xchg->back];
+}
+
+vlist *vxchg_publish(vxchg *xchg)
+{
+	/* SDL_AtomicSet is a full barrier, the frame contents are visible to
+	 * the consumer before the index is.
+	 */
+	int old = SDL_AtomicSet(&xchg->middle, xchg->back | VXCHG_FRESH);
+
+	if (old & VXCHG_FRESH)
+		SDL_AtomicAdd(&xchg->dropped, 1);
+
+	xchg->back = old & VXCHG_INDEX;
+	vlist_clear(xchg->bufs[xchg->back]);
+
+	return xchg->bufs[xchg->back];
+}
+
+vlist *vxchg_acquire(vxchg *xchg)
+{
+	int old;
+
+	if (!(SDL_AtomicGet(&xchg->middle) & VXCHG_FRESH))
+		return NULL;
+
+	/* only the producer can set the fresh bit, so it is still set here */
+	old = SDL_AtomicSet(&xchg->middle, xchg->front);
+	xchg->front = old & VXCHG_INDEX;
+
+	return xchg->bufs[xchg->front];
+}
@@ -0,0 +1,43 @@
+#ifndef __VXCHG_H
+#define __VXCHG_H
+
+#include <SDL.h>
+
+#include "emu\vlist.h"
+
+/* triple buffered hand off of finished frames from the emulator to the
+ * renderer. the producer always owns one buffer to emit into and the
+ * consumer one to draw from, the third is swapped between them with a
+ * single atomic exchange so neither side ever waits on the other.
+ */
+typedef struct
+{
+	vlist *bufs[3];
+
+	int back;            /* buffer being filled, owned by the producer */
+	int front;           /* buffer being drawn, owned by the consumer */
+	SDL_atomic_t middle; /* index of the spare buffer | VXCHG_FRESH */
+
+	/* frames the consumer never saw because a newer one replaced them,
+	 * counted by the producer, read with SDL_AtomicGet from anywhere.
+	 */
+	SDL_atomic_t dropped;
+} vxchg;
+
+int vxchg_init(vxchg *xchg);
+void vxchg_done(vxchg *xchg);
+
+/* producer side. returns the buffer to emit the next frame into. */
+vlist *vxchg_back(vxchg *xchg);
+
+/* producer side. hands the back buffer over as the latest finished frame
+ * and returns a new, cleared, back buffer.
+ */
+vlist *vxchg_publish(vxchg *xchg);
+
+/* consumer side. returns the latest finished frame, or NULL if nothing was
+ * published since the last call. the frame stays valid until the next call.
+ */
+vlist *vxchg_acquire(vxchg *xchg);
+
+#endif
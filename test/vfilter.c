@@ -0,0 +1,80 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vfilter.h"
+#include "emu\vlist.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("FAIL %s\n", what);
+		failed = 1;
+	}
+}
+
+/* the strip vertex where vector i of a list ends. every vector ends at one
+ * and a blanked move adds one before it.
+ */
+static size_t end_vertex(const vlist *list, size_t i)
+{
+	size_t v = 0;
+
+	for (size_t k = 0; k <= i; k++)
+	{
+		if (k == 0 || list->x0[k] != list->x1[k - 1] || list->y0[k] != list->y1[k - 1])
+			v++;
+		v++;
+	}
+
+	return v - 1;
+}
+
+/* merged vectors are summed in both color and vcolor */
+static void test_merge(vfilter *filter, vlist *in)
+{
+	const vlist *out;
+
+	vlist_clear(in);
+	vlist_add(in, 100, 100, 200, 100, 20, 1);
+	vlist_add(in, 200, 100, 200, 200, 30, 2);
+	vlist_add(in, 100, 100, 200, 100, 40, 3);
+	vlist_add(in, 500, 500, 600, 600, 120, 4);
+	vlist_add(in, 500, 500, 600, 600, 120, 5);
+
+	out = vfilter_run(filter, in);
+
+	check(out->cnt == 3, "merge: vector count");
+	check(filter->stats.merged == 2, "merge: merged count");
+	check(out->color[0] == 60, "merge: summed color");
+	check(out->color[1] == 30, "merge: untouched color");
+	check(out->color[2] == 127, "merge: clamped color");
+
+	for (size_t i = 0; i < out->cnt; i++)
+		check(out->vcolor[end_vertex(out, i)] == out->color[i], "merge: vcolor matches color");
+}
+
+int main(void)
+{
+	vfilter filter;
+	vlist *in = malloc(sizeof(vlist));
+
+	if (!in || !vfilter_init(&filter))
+	{
+		printf("FAIL allocation\n");
+		return 1;
+	}
+
+	test_merge(&filter, in);
+
+	vfilter_done(&filter);
+	free(in);
+
+	if (!failed)
+		printf("vfilter ok\n");
+
+	return failed;
+}